@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include "Bench.h"
+
+using namespace bench;
+
+namespace {
+
+constexpr int REPETITIONS = 3;
+constexpr const char* HEADER = "name,iterations,bytes,ns_per_op,ns_per_byte,ops_per_sec";
+
+double measure(const std::function<void()>& fn, unsigned long iterations)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (unsigned long ix = 0; ix < iterations; ++ix) {
+        fn();
+    }
+
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+std::string format(const Result& result)
+{
+    char line[256];
+
+    snprintf(line, sizeof(line), "%s,%lu,%lu,%.2f,%.4f,%.0f",
+             result.name.c_str(), result.iterations, result.bytes,
+             result.nsPerOp, result.nsPerByte(), result.opsPerSec());
+
+    return line;
+}
+
+} // namespace
+
+// Struct Result
+
+double Result::nsPerByte() const
+{
+    return bytes ? nsPerOp / bytes : 0.0;
+}
+
+double Result::opsPerSec() const
+{
+    return nsPerOp > 0.0 ? 1e9 / nsPerOp : 0.0;
+}
+
+// Class Runner
+
+Runner::Runner(const std::string& filter, double minTimeMs)
+  : mFilter(filter), mMinTimeMs(minTimeMs), mResults()
+{}
+
+void Runner::run(const std::string& name, unsigned long bytes, const std::function<void()>& fn)
+{
+    if (!mFilter.empty() && (name.find(mFilter) == std::string::npos)) {
+        return;
+    }
+
+    const double minTimeNs = mMinTimeMs * 1e6;
+
+    /* Calibrate the iteration count so one repetition takes minTimeMs */
+    unsigned long iterations = 1;
+    double elapsed = measure(fn, iterations);
+
+    while (elapsed < minTimeNs) {
+        double scale = (elapsed > 0.0) ? (minTimeNs / elapsed) * 1.2 : 100.0;
+        iterations = static_cast<unsigned long>(iterations * std::clamp(scale, 2.0, 100.0));
+        elapsed = measure(fn, iterations);
+    }
+
+    double best = elapsed / iterations;
+
+    for (int rx = 1; rx < REPETITIONS; ++rx) {
+        best = std::min(best, measure(fn, iterations) / iterations);
+    }
+
+    mResults.push_back({ name, iterations, bytes, best });
+    fprintf(stderr, "%-40s %12.2f ns/op\n", name.c_str(), best);
+}
+
+const std::vector<Result>& Runner::results() const
+{
+    return mResults;
+}
+
+bool Runner::save(const std::string& path) const
+{
+    std::ofstream file(path);
+
+    if (!file) {
+        fprintf(stderr, "Cannot write %s\n", path.c_str());
+        return false;
+    }
+
+    file << HEADER << '\n';
+
+    for (auto& result: mResults) {
+        file << format(result) << '\n';
+    }
+
+    return true;
+}
+
+void Runner::print() const
+{
+    printf("%s\n", HEADER);
+
+    for (auto& result: mResults) {
+        printf("%s\n", format(result).c_str());
+    }
+}
+
+unsigned int Runner::compare(const std::string& path, double tolerance) const
+{
+    std::ifstream file(path);
+
+    if (!file) {
+        fprintf(stderr, "Cannot read baseline %s\n", path.c_str());
+        return 1;
+    }
+
+    std::map<std::string, double> baseline;
+    std::string line;
+
+    std::getline(file, line); /* header */
+
+    while (std::getline(file, line)) {
+
+        std::stringstream fields(line);
+        std::string name, iterations, bytes, nsPerOp;
+
+        if (std::getline(fields, name, ',') && std::getline(fields, iterations, ',') &&
+            std::getline(fields, bytes, ',') && std::getline(fields, nsPerOp, ',')) {
+            baseline[name] = std::stod(nsPerOp);
+        }
+    }
+
+    unsigned int regressions = 0;
+
+    for (auto& result: mResults) {
+
+        auto found = baseline.find(result.name);
+
+        if (found == baseline.end()) {
+            continue;
+        }
+
+        double ratio = result.nsPerOp / found->second;
+
+        if (ratio > tolerance) {
+            fprintf(stderr, "REGRESSION %s: %.2f ns/op (baseline %.2f, x%.2f > x%.2f)\n",
+                    result.name.c_str(), result.nsPerOp, found->second, ratio, tolerance);
+            ++regressions;
+        }
+    }
+
+    return regressions;
+}
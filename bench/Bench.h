@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+struct Result {
+    std::string name;
+    unsigned long iterations;
+    unsigned long bytes;    /* bytes processed per operation */
+    double nsPerOp;
+
+    double nsPerByte() const;
+    double opsPerSec() const;
+};
+
+class Runner {
+public:
+    Runner(const std::string& filter, double minTimeMs);
+
+    /* Measure fn, best of a few repetitions of at least minTimeMs each */
+    void run(const std::string& name, unsigned long bytes, const std::function<void()>& fn);
+
+    const std::vector<Result>& results() const;
+
+    /* CSV: name,iterations,bytes,ns_per_op,ns_per_byte,ops_per_sec */
+    bool save(const std::string& path) const;
+    void print() const;
+
+    /* Returns the number of cases slower than baseline * tolerance */
+    unsigned int compare(const std::string& path, double tolerance) const;
+
+private:
+    std::string mFilter;
+    double mMinTimeMs;
+    std::vector<Result> mResults;
+};
+
+template <typename T>
+inline void doNotOptimize(T const& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+} // namespace
@@ -0,0 +1,616 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * Microbenchmarks of the serialization and storage hot paths.
+ *
+ *   config_bench [--filter <substring>] [--min-time <ms>]
+ *                [--output <csv>] [--baseline <csv> [--tolerance <ratio>]]
+ *
+ * Results are printed as CSV. With --baseline the exit code is the number
+ * of cases which are slower than baseline * tolerance.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#include <config.h>
+
+#include "Bench.h"
+
+using namespace config;
+using namespace bench;
+
+namespace {
+
+constexpr unsigned short IMAGE_SIZE = 4096;
+
+template <typename T>
+void benchParameter(Runner& runner, const std::string& name, const T& value)
+{
+    StorageMemory buffer(IMAGE_SIZE);
+    ConfigParameter<T> parameter(Config::SENSOR_A, value);
+
+    auto begin = buffer.begin();
+    auto end = parameter.write(begin);
+    unsigned long bytes = end.mCursor - begin.mCursor;
+
+    runner.run("param/" + name + "/write", bytes, [&]() {
+        auto it = buffer.begin();
+        doNotOptimize(parameter.write(it));
+    });
+
+    /* Stateful codecs (counter slots) must see the same image on every run */
+    StorageMemory image(IMAGE_SIZE);
+    ConfigParameter<T> source(Config::SENSOR_A, value);
+    auto imageBegin = image.begin();
+    source.write(imageBegin);
+
+    runner.run("param/" + name + "/read", bytes, [&]() {
+        auto it = image.begin();
+        doNotOptimize(parameter.read(it));
+    });
+}
+
+/* Grows the Config singleton to count parameters of mixed types */
+void populate(Config& config, unsigned int count)
+{
+    static unsigned int sCount = 1; /* id 0 is added by Config itself */
+
+    for (; sCount < count; ++sCount) {
+
+        unsigned char id = static_cast<unsigned char>(sCount);
+
+        switch (sCount % 4) {
+        case 0:
+            config.add<int>(id, static_cast<int>(sCount * 1000));
+            break;
+        case 1:
+            config.add<std::string>(id, std::string("parameter-") + std::to_string(sCount));
+            break;
+        case 2:
+            config.add<IPAddress>(id, IPAddress(192, 168, 0, static_cast<uint8_t>(sCount)));
+            break;
+        default:
+            config.add<char>(id, static_cast<char>(sCount));
+            break;
+        }
+    }
+}
+
+void benchConfig(Runner& runner)
+{
+    auto& config = Config::getInstance();
+
+    for (unsigned int count: { 10, 50, 100, 250 }) {
+
+        populate(config, count);
+
+        StorageMemory buffer(IMAGE_SIZE);
+        config.write(buffer);
+
+        /* Image size: position of the first untouched byte */
+        unsigned long bytes = IMAGE_SIZE;
+        while ((bytes > 0) && (buffer.read(bytes - 1) == static_cast<char>(0xFF))) {
+            --bytes;
+        }
+
+        std::string suffix = std::string("/").append(std::to_string(count));
+
+        runner.run("config/write" + suffix, bytes, [&]() {
+            config.writeAll(buffer);
+        });
+
+        runner.run("config/read" + suffix, bytes, [&]() {
+            config.read(buffer);
+        });
+
+        /* One CRC32 pass instead of a CRC8 per record */
+        config.setImageCrc(true);
+        config.writeAll(buffer);
+
+        runner.run("config/read/crc" + suffix, bytes, [&]() {
+            config.read(buffer);
+        });
+
+        config.setImageCrc(false);
+        config.writeAll(buffer);
+
+        /* Wake path: index the image, touch two parameters */
+        runner.run("config/read/lazy" + suffix, bytes, [&]() {
+            config.read(buffer, Config::Decode::LAZY);
+            doNotOptimize(config.get<int>(4));
+            doNotOptimize(config.get<char>(3));
+        });
+
+        /* Detach the deferred parameters from buffer */
+        config.read(buffer);
+
+        /* Worst case lookups: the last char parameter (id % 4 == 3) */
+        unsigned char last = static_cast<unsigned char>(((count - 4) / 4) * 4 + 3);
+        unsigned char first = static_cast<unsigned char>(1);
+
+        runner.run("config/get/first" + suffix, 0, [&]() {
+            doNotOptimize(config.get<std::string>(first));
+        });
+
+        runner.run("config/get/last" + suffix, 0, [&]() {
+            doNotOptimize(config.get<char>(last));
+        });
+
+        runner.run("config/set/last" + suffix, 0, [&]() {
+            doNotOptimize(config.set<char>(last, 'x'));
+        });
+
+        auto handle = config.handle<char>(last);
+
+        runner.run("config/handle/last" + suffix, 0, [&]() {
+            doNotOptimize(handle.get());
+        });
+
+        runner.run("config/load/last" + suffix, 0, [&]() {
+            doNotOptimize(config.load(buffer, last));
+        });
+
+        /* Save after one change: the record is rewritten in place */
+        config.write(buffer);
+
+        runner.run("config/write/one" + suffix, 0, [&]() {
+            config.set<char>(last, 'y');
+            config.write(buffer);
+        });
+    }
+}
+
+using BenchSchema = Schema<
+    Param<0, char, 0xA7>,
+    Param<Config::SETUP_AP_ADDRESS, IPAddress, 0x0104A8C0u>,
+    Param<Config::SETUP_AP_GATEWAY, IPAddress, 0x0104A8C0u>,
+    Param<Config::SETUP_AP_NW_MASK, IPAddress, 0x00FFFFFFu>,
+    Param<Config::WIFI_AP_CHANNEL, int, 6>,
+    Param<Config::LOCAL_IP_ADDRESS, IPAddress>,
+    Param<Config::SENSOR_A, int>,
+    Param<Config::SENSOR_B, int>,
+    Param<Config::REPORT_INTERVAL, int, 60>,
+    Param<Config::SKIP_EMPTY_REPORT, char, 1>>;
+
+void benchSchema(Runner& runner)
+{
+    static BenchSchema schema;
+    StorageMemory buffer(IMAGE_SIZE);
+
+    schema.write(buffer);
+
+    runner.run("schema/write/10", BenchSchema::SIZE, [&]() {
+        schema.write(buffer);
+    });
+
+    runner.run("schema/read/10", BenchSchema::SIZE, [&]() {
+        doNotOptimize(schema.read(buffer));
+    });
+}
+
+/* Same parameters as populate(config, 50) */
+void benchArena(Runner& runner)
+{
+    static StaticArenaConfig<50, 1024> arena;
+
+    for (unsigned int ix = 1; ix < 50; ++ix) {
+
+        unsigned char id = static_cast<unsigned char>(ix);
+
+        switch (ix % 4) {
+        case 0:
+            arena.add(id, static_cast<int>(ix * 1000));
+            break;
+        case 1:
+            arena.add(id, (std::string("parameter-") + std::to_string(ix)).c_str(), 32);
+            break;
+        case 2:
+            arena.add(id, IPAddress(192, 168, 0, static_cast<uint8_t>(ix)));
+            break;
+        default:
+            arena.add(id, static_cast<char>(ix));
+            break;
+        }
+    }
+
+    StorageMemory buffer(IMAGE_SIZE);
+    arena.write(buffer);
+
+    runner.run("arena/write/50", 0, [&]() {
+        arena.write(buffer);
+    });
+
+    runner.run("arena/read/50", 0, [&]() {
+        arena.read(buffer);
+    });
+
+    unsigned char last = 47;
+
+    runner.run("arena/get/last/50", 0, [&]() {
+        doNotOptimize(*arena.get<char>(last));
+    });
+}
+
+/* Config image of the previous cases behind a page cache */
+void benchCache(Runner& runner)
+{
+    auto& config = Config::getInstance();
+
+    StorageMemory backend(IMAGE_SIZE);
+    CachedByteBuffer cache(backend, 64, IMAGE_SIZE / 64);
+
+    config.write(cache);
+
+    runner.run("cache/config/write", 0, [&]() {
+        config.writeAll(cache);
+    });
+
+    runner.run("cache/config/read", 0, [&]() {
+        config.read(cache);
+    });
+}
+
+#if defined(__linux__)
+/* Config image of the previous cases in a mapped file, reads only: the
+ * commits are msyncs timed by the disk */
+void benchMmap(Runner& runner)
+{
+    auto& config = Config::getInstance();
+
+    const char* path = "config_bench.img";
+
+    {
+        StorageMmap storage(path, IMAGE_SIZE);
+
+        config.writeAll(storage);
+
+        runner.run("mmap/config/read", 0, [&]() {
+            config.read(storage);
+        });
+    }
+
+    unlink(path);
+}
+#endif
+
+/* Whole image rewritten with one change, only its page reaches flash */
+void benchShadow(Runner& runner)
+{
+    auto& config = Config::getInstance();
+
+    StorageFlashSim flash(IMAGE_SIZE);
+    ShadowByteBuffer shadow(flash);
+
+    config.writeAll(shadow);
+
+    char value = 'x';
+
+    runner.run("shadow/config/write/all", 0, [&]() {
+        value = (value == 'x') ? 'y' : 'x';
+        config.set<char>(3, value);
+        config.writeAll(shadow);
+    });
+}
+
+/* Config image of the previous cases on simulated NOR flash */
+void benchFlash(Runner& runner)
+{
+    auto& config = Config::getInstance();
+
+    StorageFlashSim flash(IMAGE_SIZE);
+
+    config.write(flash);
+
+    runner.run("flash/config/write/one", 0, [&]() {
+        config.touch(3);
+        config.write(flash);
+    });
+}
+
+/* Config image of the previous cases in A/B slots */
+void benchDualSlot(Runner& runner)
+{
+    auto& config = Config::getInstance();
+
+    StorageMemory backend(2 * IMAGE_SIZE);
+    DualSlotByteBuffer slots(backend);
+
+    slots.mount();
+    config.write(slots);
+
+    runner.run("slots/config/write/one", 0, [&]() {
+        config.touch(3);
+        config.write(slots);
+    });
+
+    runner.run("slots/mount", 0, [&]() {
+        doNotOptimize(slots.mount());
+    });
+
+    runner.run("slots/mount/verify", 0, [&]() {
+        doNotOptimize(slots.mount(true));
+    });
+}
+
+/* Reader side of the published state, publish of one change */
+void benchSnapshot(Runner& runner)
+{
+    auto& config = Config::getInstance();
+
+    config.publish();
+
+    runner.run("snapshot/get", 0, [&]() {
+        doNotOptimize(config.snapshot()->get<char>(3));
+    });
+
+    auto mirror_p = config.mirror<char>(3);
+
+    runner.run("snapshot/mirror", 0, [&]() {
+        doNotOptimize(mirror_p->load());
+    });
+
+    runner.run("snapshot/publish/one", 0, [&]() {
+        config.touch(3);
+        config.publish();
+    });
+}
+
+/* Ten changes coalesced into one write, against a write per change */
+void benchScheduler(Runner& runner)
+{
+    auto& config = Config::getInstance();
+
+    StorageMemory buffer(IMAGE_SIZE);
+
+    runner.run("scheduler/write/10", 0, [&]() {
+        for (int ix = 0; ix < 10; ++ix) {
+            config.set<char>(3, 'a' + ix);
+            config.write(buffer);
+        }
+    });
+
+    CommitScheduler scheduler(config, buffer);
+
+    runner.run("scheduler/notify", 0, [&]() {
+        scheduler.notify();
+    });
+
+    runner.run("scheduler/batch/10", 0, [&]() {
+        for (int ix = 0; ix < 10; ++ix) {
+            config.set<char>(3, 'a' + ix);
+        }
+        doNotOptimize(scheduler.flush());
+    });
+}
+
+/* Config of the previous cases in a record log */
+void benchLog(Runner& runner)
+{
+    auto& config = Config::getInstance();
+
+    StorageMemory buffer(4 * IMAGE_SIZE);
+    RecordLog log(buffer);
+
+    log.mount();
+    config.write(log);
+
+    runner.run("log/config/write/one", 0, [&]() {
+        config.set<char>(3, 'z');
+        config.write(log);
+    });
+
+    runner.run("log/config/read", 0, [&]() {
+        config.read(log);
+    });
+
+    /* Fill of the bank above depends on the runs, mount a fresh log */
+    StorageMemory image(4 * IMAGE_SIZE);
+    RecordLog prepared(image);
+
+    prepared.mount();
+    config.write(prepared);
+
+    runner.run("log/mount", 0, [&]() {
+        RecordLog mounted(image);
+        doNotOptimize(mounted.mount());
+    });
+}
+
+void benchCounter(Runner& runner)
+{
+    for (unsigned int slots: { 2, 8, 32, 128 }) {
+
+        StorageMemory buffer(IMAGE_SIZE);
+        PersistCounter counter(static_cast<unsigned char>(slots));
+
+        auto begin = buffer.begin();
+        auto end = counter.write(begin);
+        unsigned long bytes = end.mCursor - begin.mCursor;
+
+        std::string suffix = std::string("/").append(std::to_string(slots));
+
+        runner.run("counter/write" + suffix, bytes, [&]() {
+            ++counter;
+            auto it = buffer.begin();
+            doNotOptimize(counter.write(it));
+        });
+
+        /* Current slot in the middle of the ring */
+        StorageMemory image(IMAGE_SIZE);
+        PersistCounter written(static_cast<unsigned char>(slots));
+
+        for (unsigned int ix = 0; ix < slots / 2; ++ix) {
+            auto it = image.begin();
+            written.write(it);
+        }
+
+        runner.run("counter/read" + suffix, bytes, [&]() {
+            auto it = image.begin();
+            doNotOptimize(counter.read(it));
+        });
+    }
+
+    /* Increments persisted by the flush policy */
+    StorageMemory buffer(IMAGE_SIZE);
+    PersistCounter counter(8);
+
+    counter.setFlushPolicy(16);
+
+    auto begin = buffer.begin();
+    unsigned long bytes = counter.write(begin).mCursor - begin.mCursor;
+
+    runner.run("counter/flush/16", bytes, [&]() {
+        ++counter;
+
+        if (counter.isFlushDue()) {
+            auto it = buffer.begin();
+            doNotOptimize(counter.write(it));
+        }
+    });
+
+    runner.run("counter/accumulate", sizeof(PersistCounter::Type), [&]() {
+        counter.accumulate();
+    });
+
+    runner.run("counter/drain", sizeof(PersistCounter::Type), [&]() {
+        counter.accumulate();
+        doNotOptimize(counter.drain());
+    });
+}
+
+void benchCrc(Runner& runner)
+{
+    std::vector<char> data(IMAGE_SIZE);
+
+    for (unsigned short ix = 0; ix < data.size(); ++ix) {
+        data[ix] = static_cast<char>(ix * 31);
+    }
+
+    runner.run("crc/crc8/4", 4, [&]() {
+        doNotOptimize(crc8(data.data(), 4));
+    });
+
+    runner.run("crc/crc8/256", 256, [&]() {
+        doNotOptimize(crc8(data.data(), 256));
+    });
+
+    runner.run("crc/crc32/4096", IMAGE_SIZE, [&]() {
+        doNotOptimize(crc32(data.data(), data.size()));
+    });
+}
+
+/* Twelve channels in one region */
+void benchBank(Runner& runner)
+{
+    StorageMemory buffer(IMAGE_SIZE);
+    CounterBank bank(buffer, 12, 0, 1024);
+
+    bank.mount();
+
+    unsigned long bytes = 1 + 12 * sizeof(CounterBank::Type) + 1;
+
+    runner.run("bank/flush/12", bytes, [&]() {
+        for (unsigned char ix = 0; ix < bank.count(); ++ix) {
+            bank.add(ix);
+        }
+        doNotOptimize(bank.flush(true));
+    });
+
+    runner.run("bank/mount/12", bytes, [&]() {
+        doNotOptimize(bank.mount());
+    });
+}
+
+void usage(const char* name_p)
+{
+    fprintf(stderr, "Usage: %s [--filter <substring>] [--min-time <ms>] "
+                    "[--output <csv>] [--baseline <csv> [--tolerance <ratio>]]\n", name_p);
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::string filter;
+    std::string output;
+    std::string baseline;
+    double minTimeMs = 20.0;
+    double tolerance = 2.0;
+
+    for (int ix = 1; ix < argc; ++ix) {
+
+        std::string arg = argv[ix];
+
+        if ((ix + 1) >= argc) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        if (arg == "--filter") {
+            filter = argv[++ix];
+        } else if (arg == "--min-time") {
+            minTimeMs = std::atof(argv[++ix]);
+        } else if (arg == "--output") {
+            output = argv[++ix];
+        } else if (arg == "--baseline") {
+            baseline = argv[++ix];
+        } else if (arg == "--tolerance") {
+            tolerance = std::atof(argv[++ix]);
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    Runner runner(filter, minTimeMs);
+
+    benchParameter<char>(runner, "char", 'A');
+    benchParameter<int>(runner, "int", 123456789);
+    benchParameter<std::string>(runner, "string", std::string("a-thirty-two-character-ssid-name"));
+    benchParameter<IPAddress>(runner, "ip", IPAddress(192, 168, 4, 1));
+    benchParameter<std::vector<unsigned char>>(runner, "vector", std::vector<unsigned char>(16, 0x5A));
+    benchParameter<PersistCounter>(runner, "counter", PersistCounter(8));
+
+    benchConfig(runner);
+    benchSchema(runner);
+    benchArena(runner);
+    benchCache(runner);
+#if defined(__linux__)
+    benchMmap(runner);
+#endif
+    benchFlash(runner);
+    benchShadow(runner);
+    benchDualSlot(runner);
+    benchSnapshot(runner);
+    benchScheduler(runner);
+    benchLog(runner);
+    benchCounter(runner);
+    benchBank(runner);
+    benchCrc(runner);
+
+    runner.print();
+
+    if (!output.empty() && !runner.save(output)) {
+        return EXIT_FAILURE;
+    }
+
+    if (!baseline.empty()) {
+        return static_cast<int>(runner.compare(baseline, tolerance));
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -11,4 +11,18 @@
 
 #include <config/Config.h>
 #include <config/StorageEeprom.h>
+#include <config/StorageMemory.h>
+#include <config/StorageMmap.h>
+#include <config/StorageFlashSim.h>
+#include <config/CachedByteBuffer.h>
+#include <config/ShadowByteBuffer.h>
+#include <config/DualSlotByteBuffer.h>
+#include <config/Schema.h>
+#include <config/ArenaConfig.h>
+#include <config/ImageToc.h>
+#include <config/RecordLog.h>
 #include <config/PersistCounter.h>
+#include <config/CounterBank.h>
+#include <config/CommitScheduler.h>
+#include <config/Crc.h>
+#include <config/SeqLock.h>
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * Host stand-in for the Arduino core: only the subset used by the library.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+using byte = uint8_t;
+
+/* Places a function in instruction RAM on the ESP8266, nothing here */
+#define IRAM_ATTR
+
+/* Interrupt level of the ESP8266: xt_rsil() masks the interrupts up to
+ * level and returns the state for xt_wsr_ps() to restore, no interrupts
+ * here */
+#define xt_rsil(level) (static_cast<uint32_t>(0))
+#define xt_wsr_ps(state) (static_cast<void>(state))
+
+/* Places constant data in flash on the ESP8266, read back through
+ * pgm_read_*(); plain memory here */
+#define PROGMEM
+#define pgm_read_byte(addr) (*reinterpret_cast<const uint8_t*>(addr))
+#define pgm_read_dword(addr) (*reinterpret_cast<const uint32_t*>(addr))
+
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+unsigned long millis();
+unsigned long micros();
+
+void yield();
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * Host stand-in for the ESP8266 EEPROM emulation: a RAM image with the
+ * same interface. commit() only counts calls, nothing is persisted.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class EEPROMClass
+{
+public:
+    void begin(size_t size);
+    void end();
+
+    uint8_t read(int address);
+    void write(int address, uint8_t value);
+
+    bool commit();
+
+    uint8_t* getDataPtr();
+    const uint8_t* getConstDataPtr() const;
+
+    size_t length() const;
+
+    /* Host only: number of commits which had dirty data */
+    unsigned long commits() const;
+
+private:
+    std::vector<uint8_t> mData;
+    bool mDirty = false;
+    unsigned long mCommits = 0;
+};
+
+extern EEPROMClass EEPROM;
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * Host stand-in for the Arduino IPAddress (IPv4 only).
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+class IPAddress
+{
+public:
+    IPAddress();
+    IPAddress(uint32_t address);
+    IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth);
+
+    operator uint32_t() const;
+    IPAddress& operator=(uint32_t address);
+
+    bool operator==(const IPAddress& other) const;
+    bool operator!=(const IPAddress& other) const;
+
+    uint8_t operator[](int index) const;
+
+    std::string toString() const;
+
+private:
+    uint32_t mAddress;
+};
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * Host stand-in for the checksum library (CRC-8, polynomial 0x07).
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+
+namespace checksum {
+
+class Checksum
+{
+public:
+    enum Type { CRC8 };
+
+    explicit Checksum(Type type) : mType(type), mValue(0) {}
+
+    unsigned char calculate(const char* data_p, size_t length)
+    {
+        for (size_t ix = 0; ix < length; ++ix)
+        {
+            update(static_cast<unsigned char>(data_p[ix]));
+        }
+
+        return mValue;
+    }
+
+    template <typename Iterator>
+    unsigned char calculate(Iterator begin, Iterator end)
+    {
+        using Value = typename std::iterator_traits<Iterator>::value_type;
+
+        for (auto it = begin; it != end; ++it)
+        {
+            const Value value = *it;
+
+            for (size_t ix = 0; ix < sizeof(Value); ++ix)
+            {
+                update(reinterpret_cast<const unsigned char*>(&value)[ix]);
+            }
+        }
+
+        return mValue;
+    }
+
+private:
+    void update(unsigned char byte)
+    {
+        mValue ^= byte;
+
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            mValue = (mValue & 0x80) ? ((mValue << 1) ^ 0x07) : (mValue << 1);
+        }
+    }
+
+private:
+    Type mType;
+    unsigned char mValue;
+};
+
+} // namespace
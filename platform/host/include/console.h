@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * Host stand-in for the console library. Lines are collected by format()
+ * and handed to the sink on flush(). The default sink prints to stdout.
+ */
+
+#pragma once
+
+#include <macros.h>
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_NONE
+#endif
+
+namespace console {
+
+using Sink = void (*)(const char* line_p);
+
+void setSink(Sink sink);
+
+void format(const char* format_p, ...) __attribute__((format(printf, 1, 2)));
+void flush();
+
+} // namespace
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG(...)                       \
+    do {                               \
+        console::format(__VA_ARGS__);  \
+        console::flush();              \
+    } while (0)
+#else
+#define LOG(...) do {} while (0)
+#endif
@@ -0,0 +1,19 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#pragma once
+
+/* Byte n (little endian) of value */
+#define NBYTE(n, value) \
+    (static_cast<unsigned char>((static_cast<unsigned long long>(value) >> (8 * (n))) & 0xFF))
+
+/* Value with byte n (little endian) replaced by byte */
+#define BYTE_SET(n, value, byte)                                              \
+    ((static_cast<unsigned long long>(value) & ~(0xFFULL << (8 * (n)))) |     \
+     (static_cast<unsigned long long>(static_cast<unsigned char>(byte)) << (8 * (n))))
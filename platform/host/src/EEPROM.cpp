@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <EEPROM.h>
+
+EEPROMClass EEPROM;
+
+void EEPROMClass::begin(size_t size)
+{
+    mData.resize(size, 0xFF);
+    mDirty = false;
+}
+
+void EEPROMClass::end()
+{
+    commit();
+    mData.clear();
+}
+
+uint8_t EEPROMClass::read(int address)
+{
+    if ((address < 0) || (static_cast<size_t>(address) >= mData.size()))
+    {
+        return 0;
+    }
+
+    return mData[address];
+}
+
+void EEPROMClass::write(int address, uint8_t value)
+{
+    if ((address < 0) || (static_cast<size_t>(address) >= mData.size()))
+    {
+        return;
+    }
+
+    if (mData[address] != value)
+    {
+        mData[address] = value;
+        mDirty = true;
+    }
+}
+
+bool EEPROMClass::commit()
+{
+    if (mDirty)
+    {
+        ++mCommits;
+        mDirty = false;
+    }
+
+    return true;
+}
+
+uint8_t* EEPROMClass::getDataPtr()
+{
+    mDirty = true;
+    return mData.data();
+}
+
+const uint8_t* EEPROMClass::getConstDataPtr() const
+{
+    return mData.data();
+}
+
+size_t EEPROMClass::length() const
+{
+    return mData.size();
+}
+
+unsigned long EEPROMClass::commits() const
+{
+    return mCommits;
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <cstdio>
+
+#include <IPAddress.h>
+
+IPAddress::IPAddress()
+    : mAddress(0)
+{}
+
+IPAddress::IPAddress(uint32_t address)
+    : mAddress(address)
+{}
+
+IPAddress::IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth)
+    : mAddress(static_cast<uint32_t>(first) |
+               (static_cast<uint32_t>(second) << 8) |
+               (static_cast<uint32_t>(third) << 16) |
+               (static_cast<uint32_t>(fourth) << 24))
+{}
+
+IPAddress::operator uint32_t() const
+{
+    return mAddress;
+}
+
+IPAddress& IPAddress::operator=(uint32_t address)
+{
+    mAddress = address;
+    return *this;
+}
+
+bool IPAddress::operator==(const IPAddress& other) const
+{
+    return mAddress == other.mAddress;
+}
+
+bool IPAddress::operator!=(const IPAddress& other) const
+{
+    return !(*this == other);
+}
+
+uint8_t IPAddress::operator[](int index) const
+{
+    return static_cast<uint8_t>(mAddress >> (8 * index));
+}
+
+std::string IPAddress::toString() const
+{
+    char text[16];
+
+    snprintf(text, sizeof(text), "%u.%u.%u.%u",
+             (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+
+    return text;
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <cstdarg>
+#include <cstdio>
+#include <string>
+
+#include <console.h>
+
+namespace {
+
+void stdoutSink(const char* line_p)
+{
+    std::puts(line_p);
+}
+
+console::Sink sSink = stdoutSink;
+thread_local std::string sLine;
+
+} // namespace
+
+void console::setSink(Sink sink)
+{
+    sSink = sink ? sink : stdoutSink;
+}
+
+void console::format(const char* format_p, ...)
+{
+    char text[256];
+
+    va_list args;
+    va_start(args, format_p);
+    vsnprintf(text, sizeof(text), format_p, args);
+    va_end(args);
+
+    sLine += text;
+}
+
+void console::flush()
+{
+    sSink(sLine.c_str());
+    sLine.clear();
+}
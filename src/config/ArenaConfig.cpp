@@ -0,0 +1,457 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <climits>
+#include <string.h>
+#include <console.h>
+
+#include "ArenaConfig.h"
+#include "ImageToc.h"
+#include "Schema.h"
+
+using namespace console;
+using namespace config;
+
+// Class ArenaConfig
+
+ArenaConfig::ArenaConfig(Record* records_p, unsigned char capacity, char* arena_p, unsigned short size)
+    : mRecords_p(records_p), mCapacity(capacity), mCount(0),
+      mArena_p(arena_p), mSize(size), mUsed(0), mHasImageCrc(false) {
+
+    mIndex.fill(NO_INDEX);
+
+    add(static_cast<unsigned char>(0), static_cast<char>(0xA7));
+}
+
+ArenaConfig::~ArenaConfig() {
+
+    for (unsigned char ix = 0; ix < mCount; ++ix) {
+
+        switch (mRecords_p[ix].type) {
+        case ConfigParameterType::IP_ADDRESS:
+            std::launder(reinterpret_cast<IPAddress*>(value(mRecords_p[ix])))->~IPAddress();
+            break;
+        case ConfigParameterType::COUNTER:
+            counter(mRecords_p[ix]).~PersistCounter();
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+ArenaConfig::Record* ArenaConfig::insert(unsigned char id, ConfigParameterType type,
+                                         unsigned short size, unsigned short align) {
+
+    unsigned short offset = (mUsed + align - 1) / align * align;
+
+    if ((id == ConfigParameterBase::INVALID_ID) || (mIndex[id] != NO_INDEX) ||
+        (mCount >= mCapacity) || (offset + size > mSize)) {
+        LOG("add: skip %u", id);
+        return nullptr;
+    }
+
+    unsigned char position = mCount;
+
+    while ((position > 0) && (mRecords_p[position - 1].id > id)) {
+        mRecords_p[position] = mRecords_p[position - 1];
+        mIndex[mRecords_p[position].id] = position;
+        --position;
+    }
+
+    mRecords_p[position] = Record{ id, type, offset, 0, 0 };
+    mIndex[id] = position;
+
+    ++mCount;
+    mUsed = offset + size;
+
+    return &mRecords_p[position];
+}
+
+ArenaConfig::Record* ArenaConfig::find(unsigned char id, ConfigParameterType type) {
+
+    unsigned char position = mIndex[id];
+
+    if ((position == NO_INDEX) || (mRecords_p[position].type != type)) {
+        return nullptr;
+    }
+
+    return &mRecords_p[position];
+}
+
+char* ArenaConfig::value(const Record& record) {
+
+    return mArena_p + record.offset;
+}
+
+PersistCounter& ArenaConfig::counter(const Record& record) {
+
+    return *std::launder(reinterpret_cast<PersistCounter*>(value(record)));
+}
+
+void ArenaConfig::erase(unsigned char id, unsigned short used) {
+
+    unsigned char position = mIndex[id];
+
+    mIndex[id] = NO_INDEX;
+    --mCount;
+
+    for (; position < mCount; ++position) {
+        mRecords_p[position] = mRecords_p[position + 1];
+        mIndex[mRecords_p[position].id] = position;
+    }
+
+    mUsed = used;
+}
+
+bool ArenaConfig::add(unsigned char id, char value) {
+
+    Record* record_p = insert(id, ConfigParameterType::BYTE, sizeof(char), alignof(char));
+
+    if (record_p) {
+        new (this->value(*record_p)) char(value);
+    }
+
+    return record_p;
+}
+
+bool ArenaConfig::add(unsigned char id, int value) {
+
+    Record* record_p = insert(id, ConfigParameterType::NUMBER, sizeof(int), alignof(int));
+
+    if (record_p) {
+        new (this->value(*record_p)) int(value);
+    }
+
+    return record_p;
+}
+
+bool ArenaConfig::add(unsigned char id, const IPAddress& value) {
+
+    Record* record_p = insert(id, ConfigParameterType::IP_ADDRESS, sizeof(IPAddress), alignof(IPAddress));
+
+    if (record_p) {
+        new (this->value(*record_p)) IPAddress(value);
+    }
+
+    return record_p;
+}
+
+bool ArenaConfig::add(unsigned char id, const PersistCounter& counter) {
+
+    Record* record_p = insert(id, ConfigParameterType::COUNTER, sizeof(PersistCounter), alignof(PersistCounter));
+
+    if (record_p) {
+        new (value(*record_p)) PersistCounter(counter);
+    }
+
+    return record_p;
+}
+
+bool ArenaConfig::add(unsigned char id, const char* value_p, unsigned char capacity) {
+
+    unsigned short used = mUsed;
+
+    /* NUL terminated */
+    Record* record_p = insert(id, ConfigParameterType::STRING, capacity + 1, 1);
+
+    if (!record_p) {
+        return false;
+    }
+
+    record_p->capacity = capacity;
+    value(*record_p)[0] = '\0';
+
+    if (!setString(id, value_p)) {
+        erase(id, used);
+        return false;
+    }
+
+    return true;
+}
+
+bool ArenaConfig::add(unsigned char id, const unsigned char* data_p,
+                      unsigned char length, unsigned char capacity) {
+
+    unsigned short used = mUsed;
+
+    Record* record_p = insert(id, ConfigParameterType::ARRAY, capacity, 1);
+
+    if (!record_p) {
+        return false;
+    }
+
+    record_p->capacity = capacity;
+
+    if (!setArray(id, data_p, length)) {
+        erase(id, used);
+        return false;
+    }
+
+    return true;
+}
+
+const char* ArenaConfig::getString(unsigned char id) {
+
+    Record* record_p = find(id, ConfigParameterType::STRING);
+
+    return record_p ? value(*record_p) : nullptr;
+}
+
+bool ArenaConfig::setString(unsigned char id, const char* value_p) {
+
+    Record* record_p = find(id, ConfigParameterType::STRING);
+
+    if (!record_p) {
+        return false;
+    }
+
+    size_t length = strlen(value_p);
+
+    if (length > record_p->capacity) {
+        LOG("set: id=%d, length %u > %u", id, length, record_p->capacity);
+        return false;
+    }
+
+    memcpy(value(*record_p), value_p, length + 1);
+    record_p->length = length;
+
+    return true;
+}
+
+const unsigned char* ArenaConfig::getArray(unsigned char id, unsigned char& length) {
+
+    Record* record_p = find(id, ConfigParameterType::ARRAY);
+
+    if (!record_p) {
+        length = 0;
+        return nullptr;
+    }
+
+    length = record_p->length;
+
+    return reinterpret_cast<const unsigned char*>(value(*record_p));
+}
+
+bool ArenaConfig::setArray(unsigned char id, const unsigned char* data_p, unsigned char length) {
+
+    Record* record_p = find(id, ConfigParameterType::ARRAY);
+
+    if (!record_p || (length > record_p->capacity)) {
+        return false;
+    }
+
+    memcpy(value(*record_p), data_p, length);
+    record_p->length = length;
+
+    return true;
+}
+
+unsigned char ArenaConfig::count() const {
+
+    return mCount;
+}
+
+unsigned short ArenaConfig::used() const {
+
+    return mUsed;
+}
+
+void ArenaConfig::setImageCrc(bool hasCrc) {
+
+    mHasImageCrc = hasCrc;
+}
+
+ArenaConfig& ArenaConfig::write(ByteBuffer& buffer) {
+
+    ByteBuffer::iterator it = buffer.begin() + ImageToc::size(mCount);
+
+    /* Records which fit completely, the header lists only those */
+    unsigned char written = 0;
+
+    for (unsigned char ix = 0; ix < mCount; ++ix) {
+
+        if (it.mCursor + recordSize(mRecords_p[ix]) > buffer.size()) {
+            LOG("Write failed, image full: id=%d", mRecords_p[ix].id);
+            break;
+        }
+
+        ImageToc::writeEntry(buffer, ix, mRecords_p[ix].id, it.mCursor);
+
+        it = writeRecord(mRecords_p[ix], it);
+        ++written;
+    }
+
+    bool hasCrc = mHasImageCrc && (it.mCursor + ImageToc::CRC_SIZE <= buffer.size());
+
+    ImageToc::writeHeader(buffer, written, it.mCursor, hasCrc);
+
+    if (hasCrc) {
+        ImageToc::writeCrc(buffer, it.mCursor);
+    }
+
+    buffer.commit();
+
+    return *this;
+}
+
+ArenaConfig& ArenaConfig::read(ByteBuffer& buffer) {
+
+    ImageToc toc(buffer);
+
+    if (!toc.isValid()) {
+
+        /* Legacy image, records only */
+        ByteBuffer::iterator it = buffer.begin();
+
+        for (unsigned char ix = 0; ix < mCount; ++ix) {
+
+            if (!it.isValid()) {
+                break;
+            }
+
+            it = readRecord(mRecords_p[ix], it, false);
+        }
+
+        return *this;
+    }
+
+    /* One pass over the image instead of a check per record */
+    bool isIntact = toc.isIntact();
+
+    ImageToc::Entry entry;
+
+    for (unsigned char ix = 0; ix < toc.count(); ++ix) {
+
+        if (!toc.entry(ix, entry) || (mIndex[entry.id] == NO_INDEX)) {
+            continue;
+        }
+
+        ByteBuffer::iterator it = buffer.begin() + entry.offset;
+        readRecord(mRecords_p[mIndex[entry.id]], it, isIntact);
+    }
+
+    return *this;
+}
+
+unsigned short ArenaConfig::recordSize(const Record& record) {
+
+    switch (record.type) {
+    case ConfigParameterType::BYTE:
+        return HEADER_SIZE + SchemaCodec<char>::SIZE + 1;
+    case ConfigParameterType::NUMBER:
+        return HEADER_SIZE + SchemaCodec<int>::SIZE + 1;
+    case ConfigParameterType::IP_ADDRESS:
+        return HEADER_SIZE + SchemaCodec<IPAddress>::SIZE + 1;
+    case ConfigParameterType::STRING:
+    case ConfigParameterType::ARRAY:
+        return HEADER_SIZE + 1 + record.length + 1;
+    case ConfigParameterType::COUNTER:
+        return HEADER_SIZE + counter(record).recordSize() + 1;
+    default:
+        return 0;
+    }
+}
+
+ByteBuffer::iterator ArenaConfig::readRecord(Record& record, ByteBuffer::iterator& it, bool isVerified) {
+
+    char payload[sizeof(uint32_t)];
+    ByteBuffer::iterator nextIt = it;
+
+    switch (record.type) {
+    case ConfigParameterType::BYTE:
+        nextIt = ConfigParameterBase::readRecord(it, record.id, record.type, payload, SchemaCodec<char>::SIZE, isVerified);
+        if (nextIt != it) {
+            *reinterpret_cast<char*>(value(record)) = SchemaCodec<char>::decode(payload);
+        }
+        break;
+    case ConfigParameterType::NUMBER:
+        nextIt = ConfigParameterBase::readRecord(it, record.id, record.type, payload, SchemaCodec<int>::SIZE, isVerified);
+        if (nextIt != it) {
+            *std::launder(reinterpret_cast<int*>(value(record))) = SchemaCodec<int>::decode(payload);
+        }
+        break;
+    case ConfigParameterType::IP_ADDRESS:
+        nextIt = ConfigParameterBase::readRecord(it, record.id, record.type, payload, SchemaCodec<IPAddress>::SIZE, isVerified);
+        if (nextIt != it) {
+            *std::launder(reinterpret_cast<IPAddress*>(value(record))) = SchemaCodec<IPAddress>::decode(payload);
+        }
+        break;
+    case ConfigParameterType::STRING:
+    case ConfigParameterType::ARRAY:
+        nextIt = readBytes(record, it, isVerified);
+        break;
+    case ConfigParameterType::COUNTER:
+        nextIt = ConfigParameterBase::readCounter(it, record.id, counter(record), isVerified);
+        break;
+    default:
+        break;
+    }
+
+    return nextIt;
+}
+
+ByteBuffer::iterator ArenaConfig::writeRecord(Record& record, ByteBuffer::iterator& it) {
+
+    char payload[sizeof(uint32_t)];
+    ByteBuffer::iterator nextIt = it;
+
+    switch (record.type) {
+    case ConfigParameterType::BYTE:
+        SchemaCodec<char>::encode(*value(record), payload);
+        nextIt = ConfigParameterBase::writeRecord(it, record.id, record.type, payload, SchemaCodec<char>::SIZE);
+        break;
+    case ConfigParameterType::NUMBER:
+        SchemaCodec<int>::encode(*std::launder(reinterpret_cast<int*>(value(record))), payload);
+        nextIt = ConfigParameterBase::writeRecord(it, record.id, record.type, payload, SchemaCodec<int>::SIZE);
+        break;
+    case ConfigParameterType::IP_ADDRESS:
+        SchemaCodec<IPAddress>::encode(*std::launder(reinterpret_cast<IPAddress*>(value(record))), payload);
+        nextIt = ConfigParameterBase::writeRecord(it, record.id, record.type, payload, SchemaCodec<IPAddress>::SIZE);
+        break;
+    case ConfigParameterType::STRING:
+    case ConfigParameterType::ARRAY:
+        nextIt = ConfigParameterBase::writeBytes(it, record.id, record.type, value(record), record.length);
+        break;
+    case ConfigParameterType::COUNTER:
+        nextIt = ConfigParameterBase::writeCounter(it, record.id, counter(record));
+        break;
+    default:
+        break;
+    }
+
+    return nextIt;
+}
+
+ByteBuffer::iterator ArenaConfig::readBytes(Record& record, ByteBuffer::iterator& it, bool isVerified) {
+
+    char buffer[ConfigParameterBase::BYTES_RECORD_MAX];
+    const char* bytes_p = nullptr;
+    unsigned char length = 0;
+
+    auto nextIt = ConfigParameterBase::readBytes(it, record.id, record.type, buffer, bytes_p, length, isVerified);
+
+    if (nextIt == it) {
+        return it;
+    }
+
+    if (length > record.capacity) {
+        LOG("Skip parameter: id=%d, length %u > %u", record.id, length, record.capacity);
+        return it;
+    }
+
+    memcpy(value(record), bytes_p, length);
+    record.length = length;
+
+    if (record.type == ConfigParameterType::STRING) {
+        value(record)[length] = '\0';
+    }
+
+    return nextIt;
+}
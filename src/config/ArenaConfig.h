@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <new>
+#include <IPAddress.h>
+
+#include "ByteBuffer.h"
+#include "ConfigParameter.h"
+#include "PersistCounter.h"
+
+namespace config {
+
+/* Heap-free parameter store.
+ *
+ * Parameters are tagged records in one array sorted by id, their values
+ * live in an arena given at construction; nothing is allocated after it.
+ * read/write dispatch on the record type instead of virtual calls to the
+ * ConfigParameter record codecs and produce the same image as Config for
+ * the same parameters. Values are decoded on read and write rewrites the
+ * whole image: no lazy decode or dirty records, a value is plain memory.
+ *
+ * Strings and byte arrays reserve their capacity when added. */
+class ArenaConfig {
+public:
+    struct Record {
+        unsigned char id;
+        ConfigParameterType type;
+        unsigned short offset;      /* value offset in the arena */
+        unsigned char capacity;     /* strings and arrays */
+        unsigned char length;       /* strings and arrays */
+    };
+
+    ArenaConfig(Record* records_p, unsigned char capacity, char* arena_p, unsigned short size);
+    ~ArenaConfig();
+
+    ArenaConfig(ArenaConfig const&) = delete;
+    ArenaConfig& operator= (ArenaConfig const&) = delete;
+
+    /* false if the id exists, the records or the arena are full or the
+     * value does not fit its capacity */
+    bool add(unsigned char id, char value);
+    bool add(unsigned char id, int value);
+    bool add(unsigned char id, const IPAddress& value);
+    bool add(unsigned char id, const PersistCounter& counter);
+    bool add(unsigned char id, const char* value_p, unsigned char capacity);
+    bool add(unsigned char id, const unsigned char* data_p, unsigned char length, unsigned char capacity);
+
+    /* char, int, IPAddress or PersistCounter value, nullptr if id is not
+     * added or has another type */
+    template <typename T>
+    T* get(unsigned char id);
+
+    /* NUL terminated string, nullptr if not a string */
+    const char* getString(unsigned char id);
+    bool setString(unsigned char id, const char* value_p);
+
+    /* Array bytes, nullptr if not an array */
+    const unsigned char* getArray(unsigned char id, unsigned char& length);
+    bool setArray(unsigned char id, const unsigned char* data_p, unsigned char length);
+
+    ArenaConfig& read(ByteBuffer& buffer);
+    ArenaConfig& write(ByteBuffer& buffer);
+
+    /* As Config::setImageCrc */
+    void setImageCrc(bool hasCrc);
+
+    unsigned char count() const;
+    unsigned short used() const;
+
+private:
+    static constexpr unsigned char NO_INDEX = ConfigParameterBase::INVALID_ID;
+    static constexpr unsigned char HEADER_SIZE = 2;  /* id, type */
+
+    Record* find(unsigned char id, ConfigParameterType type);
+
+    /* New record with size bytes of the arena, nullptr if full */
+    Record* insert(unsigned char id, ConfigParameterType type, unsigned short size, unsigned short align);
+
+    /* Undoes the last insert, used is mUsed before it */
+    void erase(unsigned char id, unsigned short used);
+
+    char* value(const Record& record);
+    PersistCounter& counter(const Record& record);
+
+    unsigned short recordSize(const Record& record);
+
+    /* Type switch over the ConfigParameterBase record codecs */
+    ByteBuffer::iterator readRecord(Record& record, ByteBuffer::iterator& it, bool isVerified);
+    ByteBuffer::iterator writeRecord(Record& record, ByteBuffer::iterator& it);
+
+    /* Strings and byte arrays, up to the capacity */
+    ByteBuffer::iterator readBytes(Record& record, ByteBuffer::iterator& it, bool isVerified);
+
+private:
+    Record* mRecords_p;
+    unsigned char mCapacity;
+    unsigned char mCount;
+
+    char* mArena_p;
+    unsigned short mSize;
+    unsigned short mUsed;
+
+    /* id -> position in mRecords_p, NO_INDEX if not added */
+    std::array<unsigned char, 256> mIndex;
+
+    bool mHasImageCrc;
+};
+
+template <unsigned char Records, unsigned short Bytes>
+struct ArenaConfigStorage {
+    std::array<ArenaConfig::Record, Records> mRecords;
+    alignas(std::max_align_t) char mArena[Bytes];
+};
+
+/* ArenaConfig with statically allocated records and arena, the storage
+ * base is constructed before ArenaConfig */
+template <unsigned char Records, unsigned short Bytes>
+class StaticArenaConfig
+  : private ArenaConfigStorage<Records, Bytes>,
+    public ArenaConfig {
+public:
+    StaticArenaConfig()
+        : ArenaConfigStorage<Records, Bytes>(),
+          ArenaConfig(this->mRecords.data(), Records, this->mArena, Bytes) {}
+};
+
+template <typename T>
+T* ArenaConfig::get(unsigned char id) {
+
+    static_assert((ConfigParameterTypeOf<T>::value == ConfigParameterType::BYTE) ||
+                  (ConfigParameterTypeOf<T>::value == ConfigParameterType::NUMBER) ||
+                  (ConfigParameterTypeOf<T>::value == ConfigParameterType::IP_ADDRESS) ||
+                  (ConfigParameterTypeOf<T>::value == ConfigParameterType::COUNTER),
+                  "Use getString/getArray");
+
+    Record* record_p = find(id, ConfigParameterTypeOf<T>::value);
+
+    return record_p ? std::launder(reinterpret_cast<T*>(value(*record_p))) : nullptr;
+}
+
+} // namespace
@@ -29,103 +29,59 @@ ByteBuffer::iterator ByteBuffer::end()
     return ByteBuffer::iterator(this, size());
 }
 
-unsigned short ByteBuffer::read(const iterator& it, char* value_p, unsigned short length)
+unsigned short ByteBuffer::remaining(const iterator& it)
 {
-    iterator retIt = it;
-
-    for (unsigned short ix = 0; ix < length; ++ix)
-    {
-        value_p[ix] = *retIt++;
-    }
-
-    return length;
+    return (it.mCursor < it.mEnd) ? (it.mEnd - it.mCursor) : 0;
 }
 
-unsigned short ByteBuffer::write(const iterator& it, const char* value_p, unsigned short length)
+unsigned short ByteBuffer::read(const iterator& it, char* value_p, unsigned short length)
 {
-    iterator retIt = it;
-
-    for (unsigned short ix = 0; ix < length; ++ix)
-    {
-        *retIt++ = value_p[ix];
-    }
-
-    return length;
-}
-
-// Class ByteBuffer::reference
+    unsigned short available = std::min<unsigned short>(length, remaining(it));
+    unsigned short count = available;
 
-ByteBuffer::reference::reference(iterator& it) : mIter(it) {}
-
-ByteBuffer::iterator& ByteBuffer::reference::operator=(const char value)
-{
-    if (mIter != mIter.mBuffer_p->end())
+    if (it.mData_p)
     {
-        mIter.mBuffer_p->write(mIter.mCursor, value);
+        std::copy(it.data(), it.data() + available, value_p);
     }
-
-    return mIter;
-}
-
-ByteBuffer::reference::operator char() const
-{
-    if (mIter != mIter.mBuffer_p->end())
+    else
     {
-        return mIter.mBuffer_p->read(mIter.mCursor);
+        count = readBlock(it.mCursor, value_p, available);
     }
 
-    return (-1);
-}
-
-// Class ByteBuffer::iterator
+    // Past the end reads as through ByteBuffer::reference
+    std::fill(value_p + count, value_p + length, static_cast<char>(-1));
 
-ByteBuffer::iterator::iterator(ByteBuffer* buffer_p, difference_type cursor)
-    : mBuffer_p(buffer_p), mCursor(cursor)
-{}
-
-ByteBuffer::iterator ByteBuffer::iterator::operator++(int)
-{
-    return ByteBuffer::iterator(mBuffer_p, mCursor++);
+    return count;
 }
 
-ByteBuffer::iterator& ByteBuffer::iterator::operator++()
-{
-    mCursor += (*this != mBuffer_p->end()) ? 1 : 0;
-    return *this;
-}
-
-ByteBuffer::iterator& ByteBuffer::iterator::operator+=(const difference_type distance)
+unsigned short ByteBuffer::write(const iterator& it, const char* value_p, unsigned short length)
 {
-    auto end = mBuffer_p->end();
-    mCursor = std::min<short>(mCursor + distance, end.mCursor);
+    unsigned short available = std::min<unsigned short>(length, remaining(it));
 
-    return *this;
+    return writeBlock(it.mCursor, value_p, available);
 }
 
-ByteBuffer::iterator ByteBuffer::iterator::operator+(const difference_type distance)
+const char* ByteBuffer::data()
 {
-    auto end = mBuffer_p->end();
-    auto cursor = std::min<short>(mCursor + distance, end.mCursor);
-
-    return iterator(mBuffer_p, cursor);
+    return nullptr;
 }
 
-bool ByteBuffer::iterator::operator==(const ByteBuffer::iterator& other) const
+unsigned short ByteBuffer::readBlock(unsigned short index, char* data_p, unsigned short length)
 {
-    return this->mCursor == other.mCursor;
-}
+    for (unsigned short ix = 0; ix < length; ++ix)
+    {
+        data_p[ix] = read(index + ix);
+    }
 
-bool ByteBuffer::iterator::operator!=(const ByteBuffer::iterator& other) const
-{
-    return !(*this == other);
+    return length;
 }
 
-ByteBuffer::reference ByteBuffer::iterator::operator*()
+unsigned short ByteBuffer::writeBlock(unsigned short index, const char* data_p, unsigned short length)
 {
-    return ByteBuffer::reference(*this);
-}
+    for (unsigned short ix = 0; ix < length; ++ix)
+    {
+        write(index + ix, data_p[ix]);
+    }
 
-bool ByteBuffer::iterator::isValid() const
-{
-    return (*this != mBuffer_p->end());
+    return length;
 }
@@ -24,6 +24,9 @@ public:
     iterator begin();
     iterator end();
 
+    /* Bytes from it to the end of the buffer */
+    unsigned short remaining(const iterator& it);
+
     unsigned short read(const iterator& it, char* value_p, unsigned short length);
     unsigned short write(const iterator& it, const char* value_p, unsigned short length);
 
@@ -40,59 +43,249 @@ public:
     virtual const char read(unsigned short index) = 0;
     virtual void write(unsigned short index, const char value) = 0;
 
-    virtual void commit() = 0;
-    virtual unsigned short size() = 0;
-};
-
-class ByteBuffer::reference
-{
-public:
-    reference(iterator& it) noexcept;
-
-    reference(const reference&) = delete;
-    reference& operator=(const reference&) = delete;
+    /* Bulk transfer of up to length bytes at index, returns bytes copied.
+     * The defaults fall back to read(index)/write(index) per byte,
+     * backends override them with a single copy. */
+    virtual unsigned short readBlock(unsigned short index, char* data_p, unsigned short length);
+    virtual unsigned short writeBlock(unsigned short index, const char* data_p, unsigned short length);
 
-    reference(reference&&) = delete;
-    reference& operator=(reference&&) = delete;
+    /* Backends which are one contiguous block in RAM return it, writes
+     * still go through write()/writeBlock(). */
+    virtual const char* data();
 
-    iterator& operator=(const char value) noexcept;
-    operator char() const noexcept;
-
-private:
-    iterator& mIter;
+    virtual void commit() = 0;
+    virtual unsigned short size() = 0;
 };
 
+/* Random access iterator, the buffer bound and the data() pointer are
+ * cached at construction, so moving it around costs no virtual calls.
+ * Dereferencing reads straight from data() of contiguous buffers. */
 class ByteBuffer::iterator
 {
 public:
-    using iterator_category = std::forward_iterator_tag;
+    using iterator_category = std::random_access_iterator_tag;
     using value_type = char;
-    using difference_type = unsigned short;
+    using difference_type = int;
     using pointer = const char*;
     using reference = ByteBuffer::reference;
 
-    iterator(ByteBuffer* buffer_p, difference_type cursor = 0);
+    iterator();
+    iterator(ByteBuffer* buffer_p, unsigned short cursor = 0);
 
     iterator operator++(int); /* postfix */
     iterator& operator++();   /* prefix */
+    iterator operator--(int);
+    iterator& operator--();
+
     iterator& operator+=(const difference_type distance);
+    iterator& operator-=(const difference_type distance);
 
-    iterator operator+(const difference_type distance);
+    iterator operator+(const difference_type distance) const;
+    iterator operator-(const difference_type distance) const;
+    difference_type operator-(const iterator& other) const;
 
     bool operator==(const iterator& other) const;
     bool operator!=(const iterator& other) const;
+    bool operator<(const iterator& other) const;
+    bool operator>(const iterator& other) const;
+    bool operator<=(const iterator& other) const;
+    bool operator>=(const iterator& other) const;
 
-    reference operator*() noexcept;
+    reference operator*() const noexcept;
+    reference operator[](const difference_type distance) const noexcept;
 
     bool isValid() const;
 
+    /* Contiguous bytes at the cursor, nullptr if the buffer has no data() */
+    const char* data() const;
+
 public:
     friend reference;
 
     ByteBuffer* mBuffer_p;
-    difference_type mCursor;
+    unsigned short mCursor;
+    unsigned short mEnd;
+    const char* mData_p;
+};
+
+class ByteBuffer::reference
+{
+public:
+    reference(const iterator& it) noexcept;
+
+    reference(const reference&) = delete;
+    reference(reference&&) = delete;
+
+    /* Assignment copies the referenced byte, as for *out = *in */
+    reference& operator=(const reference& other) noexcept;
+    reference& operator=(const char value) noexcept;
+    operator char() const noexcept;
+
+private:
+    iterator mIter;
 };
 
+// Class ByteBuffer::iterator
+
+inline ByteBuffer::iterator::iterator()
+    : mBuffer_p(nullptr), mCursor(0), mEnd(0), mData_p(nullptr)
+{}
+
+inline ByteBuffer::iterator::iterator(ByteBuffer* buffer_p, unsigned short cursor)
+    : mBuffer_p(buffer_p),
+      mCursor(cursor),
+      mEnd(buffer_p->size()),
+      mData_p(buffer_p->data())
+{}
+
+inline ByteBuffer::iterator ByteBuffer::iterator::operator++(int)
+{
+    iterator it = *this;
+    ++(*this);
+    return it;
+}
+
+inline ByteBuffer::iterator& ByteBuffer::iterator::operator++()
+{
+    mCursor += (mCursor < mEnd) ? 1 : 0;
+    return *this;
+}
+
+inline ByteBuffer::iterator ByteBuffer::iterator::operator--(int)
+{
+    iterator it = *this;
+    --(*this);
+    return it;
+}
+
+inline ByteBuffer::iterator& ByteBuffer::iterator::operator--()
+{
+    mCursor -= (mCursor > 0) ? 1 : 0;
+    return *this;
+}
+
+inline ByteBuffer::iterator& ByteBuffer::iterator::operator+=(const difference_type distance)
+{
+    int cursor = mCursor + distance;
+
+    mCursor = (cursor < 0) ? 0 : (cursor > mEnd) ? mEnd : cursor;
+    return *this;
+}
+
+inline ByteBuffer::iterator& ByteBuffer::iterator::operator-=(const difference_type distance)
+{
+    return *this += -distance;
+}
+
+inline ByteBuffer::iterator ByteBuffer::iterator::operator+(const difference_type distance) const
+{
+    iterator it = *this;
+    return it += distance;
+}
+
+inline ByteBuffer::iterator ByteBuffer::iterator::operator-(const difference_type distance) const
+{
+    iterator it = *this;
+    return it -= distance;
+}
+
+inline ByteBuffer::iterator::difference_type
+ByteBuffer::iterator::operator-(const iterator& other) const
+{
+    return static_cast<difference_type>(mCursor) - other.mCursor;
+}
+
+inline bool ByteBuffer::iterator::operator==(const iterator& other) const
+{
+    return mCursor == other.mCursor;
+}
+
+inline bool ByteBuffer::iterator::operator!=(const iterator& other) const
+{
+    return !(*this == other);
+}
+
+inline bool ByteBuffer::iterator::operator<(const iterator& other) const
+{
+    return mCursor < other.mCursor;
+}
+
+inline bool ByteBuffer::iterator::operator>(const iterator& other) const
+{
+    return other < *this;
+}
+
+inline bool ByteBuffer::iterator::operator<=(const iterator& other) const
+{
+    return !(other < *this);
+}
+
+inline bool ByteBuffer::iterator::operator>=(const iterator& other) const
+{
+    return !(*this < other);
+}
+
+inline ByteBuffer::reference ByteBuffer::iterator::operator*() const noexcept
+{
+    return ByteBuffer::reference(*this);
+}
+
+inline ByteBuffer::reference
+ByteBuffer::iterator::operator[](const difference_type distance) const noexcept
+{
+    return ByteBuffer::reference(*this + distance);
+}
+
+inline bool ByteBuffer::iterator::isValid() const
+{
+    return mCursor < mEnd;
+}
+
+inline const char* ByteBuffer::iterator::data() const
+{
+    return mData_p ? (mData_p + mCursor) : nullptr;
+}
+
+inline ByteBuffer::iterator operator+(ByteBuffer::iterator::difference_type distance,
+                                      const ByteBuffer::iterator& it)
+{
+    return it + distance;
+}
+
+// Class ByteBuffer::reference
+
+inline ByteBuffer::reference::reference(const iterator& it) noexcept
+    : mIter(it)
+{}
+
+inline ByteBuffer::reference& ByteBuffer::reference::operator=(const reference& other) noexcept
+{
+    return *this = static_cast<char>(other);
+}
+
+inline ByteBuffer::reference& ByteBuffer::reference::operator=(const char value) noexcept
+{
+    if (mIter.isValid())
+    {
+        mIter.mBuffer_p->write(mIter.mCursor, value);
+    }
+
+    return *this;
+}
+
+inline ByteBuffer::reference::operator char() const noexcept
+{
+    if (mIter.isValid())
+    {
+        return mIter.mData_p ? mIter.mData_p[mIter.mCursor]
+                             : mIter.mBuffer_p->read(mIter.mCursor);
+    }
+
+    return (-1);
+}
+
+// Class ByteBuffer
+
 template <typename Type>
 unsigned short ByteBuffer::read(const iterator& it, Type* value_p)
 {
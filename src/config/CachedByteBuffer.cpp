@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <algorithm>
+#include <string.h>
+#include <console.h>
+
+#include "CachedByteBuffer.h"
+
+using namespace console;
+using namespace config;
+
+CachedByteBuffer::CachedByteBuffer(ByteBuffer& backend, unsigned short pageSize, unsigned char pages)
+  : mBackend(backend),
+    mPageSize(std::max<unsigned short>(pageSize, 1)),
+    mSize(backend.size()),
+    mPages(std::min<unsigned char>(std::max<unsigned char>(pages, 1), NO_SLOT - 1),
+           Page{ NO_PAGE, 0, false }),
+    mData(mPages.size() * mPageSize),
+    mSlots((mSize + mPageSize - 1) / mPageSize, NO_SLOT),
+    mClock(0),
+    mStats{},
+    mIsBackendDirty(false)
+{}
+
+unsigned short CachedByteBuffer::size()
+{
+    return mSize;
+}
+
+const char CachedByteBuffer::read(unsigned short index)
+{
+    unsigned char slot = fetch(index);
+
+    return slotData(slot)[index % mPageSize];
+}
+
+void CachedByteBuffer::write(unsigned short index, const char value)
+{
+    unsigned char slot = fetch(index);
+    char& cached = slotData(slot)[index % mPageSize];
+
+    if (cached != value) {
+        cached = value;
+        mPages[slot].dirty = true;
+    }
+}
+
+unsigned short CachedByteBuffer::readBlock(unsigned short index, char* data_p, unsigned short length)
+{
+    unsigned short done = 0;
+
+    while (done < length) {
+
+        unsigned short offset = (index + done) % mPageSize;
+        unsigned short count = std::min<unsigned short>(length - done, mPageSize - offset);
+        unsigned char slot = fetch(index + done);
+
+        memcpy(data_p + done, slotData(slot) + offset, count);
+        done += count;
+    }
+
+    return length;
+}
+
+unsigned short CachedByteBuffer::writeBlock(unsigned short index, const char* data_p, unsigned short length)
+{
+    unsigned short done = 0;
+
+    while (done < length) {
+
+        unsigned short offset = (index + done) % mPageSize;
+        unsigned short count = std::min<unsigned short>(length - done, mPageSize - offset);
+        unsigned char slot = fetch(index + done);
+        char* cached_p = slotData(slot) + offset;
+
+        if (memcmp(cached_p, data_p + done, count) != 0) {
+            memcpy(cached_p, data_p + done, count);
+            mPages[slot].dirty = true;
+        }
+
+        done += count;
+    }
+
+    return length;
+}
+
+void CachedByteBuffer::commit()
+{
+    for (unsigned char slot = 0; slot < mPages.size(); ++slot) {
+
+        if (mPages[slot].dirty) {
+            flush(slot);
+        }
+    }
+
+    if (mIsBackendDirty) {
+        mBackend.commit();
+        mIsBackendDirty = false;
+    }
+}
+
+void CachedByteBuffer::invalidate()
+{
+    for (auto& page: mPages) {
+        page = Page{ NO_PAGE, 0, false };
+    }
+
+    std::fill(mSlots.begin(), mSlots.end(), NO_SLOT);
+}
+
+const CachedByteBuffer::Stats& CachedByteBuffer::stats() const
+{
+    return mStats;
+}
+
+void CachedByteBuffer::resetStats()
+{
+    mStats = Stats{};
+}
+
+unsigned char CachedByteBuffer::fetch(unsigned short index)
+{
+    unsigned short number = index / mPageSize;
+    unsigned char slot = mSlots[number];
+
+    if (slot != NO_SLOT) {
+        ++mStats.hits;
+        mPages[slot].used = ++mClock;
+        return slot;
+    }
+
+    ++mStats.misses;
+
+    /* Least recently used slot, free slots have used == 0 */
+    unsigned char victim = 0;
+
+    for (slot = 1; slot < mPages.size(); ++slot) {
+
+        if (mPages[slot].used < mPages[victim].used) {
+            victim = slot;
+        }
+    }
+
+    Page& page = mPages[victim];
+
+    if (page.number != NO_PAGE) {
+
+        ++mStats.evictions;
+
+        if (page.dirty) {
+            flush(victim);
+        }
+
+        mSlots[page.number] = NO_SLOT;
+    }
+
+    page.number = number;
+    page.used = ++mClock;
+    page.dirty = false;
+
+    mSlots[number] = victim;
+
+    mBackend.readBlock(number * mPageSize, slotData(victim), pageLength(number));
+
+    return victim;
+}
+
+void CachedByteBuffer::flush(unsigned char slot)
+{
+    Page& page = mPages[slot];
+
+    LOG("Cache flush: page=%u", page.number);
+
+    mBackend.writeBlock(page.number * mPageSize, slotData(slot), pageLength(page.number));
+    page.dirty = false;
+    mIsBackendDirty = true;
+
+    ++mStats.flushes;
+}
+
+char* CachedByteBuffer::slotData(unsigned char slot)
+{
+    return mData.data() + slot * mPageSize;
+}
+
+unsigned short CachedByteBuffer::pageLength(unsigned short number)
+{
+    unsigned long start = static_cast<unsigned long>(number) * mPageSize;
+
+    return std::min<unsigned long>(mPageSize, mSize - start);
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "ByteBuffer.h"
+
+namespace config {
+
+/* Write-back page cache in front of another ByteBuffer.
+ *
+ * Reads are served from RAM pages, writes only mark pages dirty. Dirty
+ * pages reach the backend on commit(), or earlier when the least recently
+ * used page has to be evicted; the backend is committed on commit() only. */
+class CachedByteBuffer : public ByteBuffer {
+public:
+    struct Stats {
+        unsigned long hits;
+        unsigned long misses;
+        unsigned long flushes;    /* dirty pages written to the backend */
+        unsigned long evictions;
+    };
+
+    CachedByteBuffer(ByteBuffer& backend, unsigned short pageSize = 64, unsigned char pages = 8);
+    ~CachedByteBuffer() = default;
+
+    using ByteBuffer::read;
+    using ByteBuffer::write;
+
+    const char read(unsigned short index);
+    void write(unsigned short index, const char value);
+
+    unsigned short readBlock(unsigned short index, char* data_p, unsigned short length);
+    unsigned short writeBlock(unsigned short index, const char* data_p, unsigned short length);
+
+    void commit();
+    unsigned short size();
+
+    /* Drop all pages without writing them back */
+    void invalidate();
+
+    const Stats& stats() const;
+    void resetStats();
+
+private:
+    static constexpr unsigned short NO_PAGE = static_cast<unsigned short>(-1);
+    static constexpr unsigned char NO_SLOT = static_cast<unsigned char>(-1);
+
+    struct Page {
+        unsigned short number;
+        unsigned long used;
+        bool dirty;
+    };
+
+    /* Cache slot holding the page with index, loaded on a miss */
+    unsigned char fetch(unsigned short index);
+    void flush(unsigned char slot);
+
+    char* slotData(unsigned char slot);
+    unsigned short pageLength(unsigned short number);
+
+private:
+    ByteBuffer& mBackend;
+    unsigned short mPageSize;
+    unsigned short mSize;
+
+    std::vector<Page> mPages;
+    std::vector<char> mData;
+    std::vector<unsigned char> mSlots;  /* page number -> cache slot */
+
+    unsigned long mClock;
+    Stats mStats;
+
+    /* Pages reached the backend since its last commit, evictions too */
+    bool mIsBackendDirty;
+};
+
+} // namespace
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <Arduino.h>
+#include <console.h>
+
+#include "CommitScheduler.h"
+
+using namespace console;
+using namespace config;
+
+// Class CommitScheduler
+
+CommitScheduler::CommitScheduler(Config& config, ByteBuffer& buffer, unsigned long quiet, unsigned long maxDelay)
+    : mConfig(config),
+      mBuffer(buffer),
+      mQuiet(quiet),
+      mMaxDelay(maxDelay),
+      mFirstChange(NOT_PENDING),
+      mLastChange(0),
+      mWrites(0)
+#if CONFIG_PLATFORM_HOST
+      , mIsRunning(false)
+#endif
+{
+    mPrevious = mConfig.onChange([this](uint8_t id) {
+
+        notify();
+
+        if (mPrevious) {
+            mPrevious(id);
+        }
+    });
+}
+
+CommitScheduler::~CommitScheduler() {
+
+#if CONFIG_PLATFORM_HOST
+    stop();
+#endif
+
+    mConfig.onChange(std::move(mPrevious));
+}
+
+void CommitScheduler::notify() {
+
+    unsigned long now = millis();
+    unsigned long first = NOT_PENDING;
+
+    mLastChange = now;
+
+    /* Starts the pending period, keeps a running one */
+    mFirstChange.compare_exchange_strong(first, (now != NOT_PENDING) ? now : now - 1);
+}
+
+bool CommitScheduler::isPending() const {
+
+    return mFirstChange != NOT_PENDING;
+}
+
+bool CommitScheduler::isDue() const {
+
+    unsigned long first = mFirstChange;
+
+    if (first == NOT_PENDING) {
+        return false;
+    }
+
+    unsigned long now = millis();
+
+    return (now - mLastChange >= mQuiet) || (mMaxDelay && (now - first >= mMaxDelay));
+}
+
+bool CommitScheduler::loop() {
+
+    return isDue() && flush();
+}
+
+bool CommitScheduler::flush() {
+
+#if CONFIG_PLATFORM_HOST
+    std::lock_guard<std::mutex> guard(mMutex);
+#endif
+
+    /* Changes during the write are pending again */
+    if (mFirstChange.exchange(NOT_PENDING) == NOT_PENDING) {
+        return false;
+    }
+
+    mConfig.write(mBuffer);
+    ++mWrites;
+
+    LOG("Config committed, %lu writes", mWrites.load());
+
+    return true;
+}
+
+unsigned long CommitScheduler::writes() const {
+
+    return mWrites;
+}
+
+#if CONFIG_PLATFORM_HOST
+
+void CommitScheduler::start(unsigned long period) {
+
+    std::lock_guard<std::mutex> guard(mThreadMutex);
+
+    if (mIsRunning) {
+        return;
+    }
+
+    mIsRunning = true;
+
+    mThread = std::thread([this, period]() {
+
+        std::unique_lock<std::mutex> lock(mThreadMutex);
+
+        while (mIsRunning) {
+
+            lock.unlock();
+            loop();
+            lock.lock();
+
+            mWake.wait_for(lock, std::chrono::milliseconds(period), [this]() { return !mIsRunning; });
+        }
+    });
+}
+
+void CommitScheduler::stop() {
+
+    {
+        std::lock_guard<std::mutex> guard(mThreadMutex);
+        mIsRunning = false;
+    }
+
+    mWake.notify_all();
+
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+std::unique_lock<std::mutex> CommitScheduler::lock() {
+
+    return std::unique_lock<std::mutex>(mMutex);
+}
+
+#endif
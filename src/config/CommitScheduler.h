@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#pragma once
+
+#include <atomic>
+
+#if CONFIG_PLATFORM_HOST
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+#include "ByteBuffer.h"
+#include "Config.h"
+
+namespace config {
+
+/* Coalesces the changes of a Config into one write and commit.
+ *
+ * Listens to Config::onChange. Once no change came for quiet ms, or
+ * maxDelay ms after the first pending change (0: no bound), loop() writes
+ * the Config into buffer. Call loop() from the sketch loop; on the host
+ * start() runs it in a thread, changes to the Config then have to hold
+ * lock(). flush() writes the pending changes at once, for shutdown.
+ *
+ * The listener set before the scheduler is chained to and put back when
+ * the scheduler goes. One set after it has to chain to it in turn and
+ * be removed first. */
+class CommitScheduler {
+public:
+    CommitScheduler(Config& config, ByteBuffer& buffer, unsigned long quiet = 1000, unsigned long maxDelay = 0);
+    ~CommitScheduler();
+
+    CommitScheduler(CommitScheduler const&) = delete;
+    CommitScheduler& operator= (CommitScheduler const&) = delete;
+
+    /* A change, the listener calls it */
+    void notify();
+
+    bool isPending() const;
+    bool isDue() const;
+
+    /* Writes once due, true if it wrote */
+    bool loop();
+
+    /* Writes if anything is pending, true if it wrote */
+    bool flush();
+
+    /* Writes so far */
+    unsigned long writes() const;
+
+#if CONFIG_PLATFORM_HOST
+    /* Calls loop() every period ms from a thread until stop() */
+    void start(unsigned long period = 10);
+    void stop();
+
+    /* Held by the thread while it writes */
+    std::unique_lock<std::mutex> lock();
+#endif
+
+private:
+    Config& mConfig;
+    ByteBuffer& mBuffer;
+
+    /* Listener of the Config before the scheduler */
+    std::function<void(uint8_t id)> mPrevious;
+    unsigned long mQuiet;
+    unsigned long mMaxDelay;
+
+    /* millis() of the first pending change, NOT_PENDING if none: one
+     * word, so pending and its start are published together */
+    static constexpr unsigned long NOT_PENDING = static_cast<unsigned long>(-1);
+
+    std::atomic<unsigned long> mFirstChange;
+    std::atomic<unsigned long> mLastChange;
+    std::atomic<unsigned long> mWrites;
+
+#if CONFIG_PLATFORM_HOST
+    std::mutex mMutex;
+    std::mutex mThreadMutex;
+    std::condition_variable mWake;
+    std::thread mThread;
+    bool mIsRunning;
+#endif
+};
+
+} // namespace
@@ -7,32 +7,114 @@
  * (at your option) any later version.
  */
 
+#include <algorithm>
 #include <string>
 #include <console.h>
 
 #include "Config.h"
+#include "ImageToc.h"
 
 using namespace console;
 using namespace config;
 
 Config::Config()
-    : mParameters() {
+    : mParameters(), mImage_p(nullptr), mHasImageCrc(false), mSnapshot_p(nullptr) {
 
-    add(new ConfigParameter<char>(0, 0xA7));
+    mIndex.fill(NO_INDEX);
+
+    for (auto & reader: mReaders) {
+        reader.claimed = false;
+        reader.snapshot_p = nullptr;
+    }
+
+    add<char>(0, 0xA7);
+
+    publish();
+}
+
+Config::~Config() {
+
+    /* No reader is left at exit */
+    for (auto snapshot_p: mRetired) {
+        delete snapshot_p;
+    }
+
+    delete mSnapshot_p.load();
+}
+
+void Config::insert(std::shared_ptr<ConfigParameterBase> parameter) {
+
+    unsigned char id = parameter->getId();
+
+    if ((id == ConfigParameterBase::INVALID_ID) || (mIndex[id] != NO_INDEX)) {
+        LOG("add: skip %u", id);
+        return;
+    }
+
+    auto position = std::lower_bound(mParameters.begin(), mParameters.end(), id,
+        [](const std::shared_ptr<ConfigParameterBase>& parameter, unsigned char id) {
+            return parameter->getId() < id;
+        });
+
+    position = mParameters.insert(position, std::move(parameter));
+    mUnpublished.set(id);
+
+    // The next write has to make room for it
+    mImage_p = nullptr;
+
+    // Positions of the following parameters have moved
+    for (auto it = position; it != mParameters.end(); ++it) {
+        mIndex[(*it)->getId()] = it - mParameters.begin();
+    }
 }
 
 Config& Config::write(ByteBuffer& buffer) {
 
-    ByteBuffer::iterator it = buffer.begin();
+    if ((&buffer == mImage_p) && writeDirty(buffer)) {
+        return *this;
+    }
 
-    for (auto & [ key, parameter]: mParameters) {
+    return writeAll(buffer);
+}
 
-        if (!it.isValid()) {
-            LOG("Write failed, invalid iterator");
+Config& Config::writeAll(ByteBuffer& buffer) {
+
+    /* Deferred records may be in the image which is overwritten */
+    for (auto & parameter: mParameters) {
+        parameter->decode();
+    }
+
+    unsigned char count = mParameters.size();
+    ByteBuffer::iterator it = buffer.begin() + ImageToc::size(count);
+
+    mImage_p = &buffer;
+
+    /* Records which fit completely, the header lists only those */
+    unsigned char written = 0;
+
+    for (unsigned char ix = 0; ix < count; ++ix) {
+
+        if (it.mCursor + mParameters[ix]->recordSize() > buffer.size()) {
+            LOG("Write failed, image full: id=%d", mParameters[ix]->getId());
+            mImage_p = nullptr;
             break;
         }
 
-        it = parameter->write(it);
+        ImageToc::writeEntry(buffer, ix, mParameters[ix]->getId(), it.mCursor);
+
+        auto nextIt = mParameters[ix]->write(it);
+        mParameters[ix]->setRecord(it.mCursor, nextIt - it);
+
+        it = nextIt;
+        ++written;
+    }
+
+    bool hasCrc = mHasImageCrc && (it.mCursor + ImageToc::CRC_SIZE <= buffer.size());
+
+    ImageToc::writeHeader(buffer, written, it.mCursor, hasCrc);
+
+    if (hasCrc) {
+        ImageToc::writeCrc(buffer, it.mCursor);
     }
 
     buffer.commit();
@@ -40,11 +122,417 @@ Config& Config::write(ByteBuffer& buffer) {
     return *this;
 }
 
-Config& Config::read(ByteBuffer& buffer) {
+void Config::setImageCrc(bool hasCrc) {
+
+    mHasImageCrc = hasCrc;
+}
+
+bool Config::writeDirty(ByteBuffer& buffer) {
+
+    ImageToc toc(buffer);
+
+    /* The buffer may have been replaced or rewritten since */
+    if (!toc.isValid() || mParameters.empty() || (toc.count() != mParameters.size()) ||
+        (toc.hasCrc() != mHasImageCrc)) {
+        LOG("Image changed, rewrite it");
+        return false;
+    }
+
+    /* Each entry places its record where it was; with the end offset
+     * that fixes the record lengths as well */
+    char bytes[ImageToc::ENTRIES_BLOCK * ImageToc::ENTRY_SIZE];
+    const char* entry_p = nullptr;
+    unsigned char ix = 0;
+    unsigned char left = 0;
+
+    for (auto & parameter: mParameters) {
+
+        if (parameter->isDirty() && (parameter->recordSize() != parameter->getRecordLength())) {
+            LOG("Record size changed: id=%d", parameter->getId());
+            return false;
+        }
+
+        if (!left) {
+            entry_p = toc.entryBytes(ix, bytes, left);
+        }
+
+        if (!ImageToc::isEntry(entry_p, parameter->getId(), parameter->getRecordOffset())) {
+            LOG("Image changed, rewrite it: id=%d", parameter->getId());
+            return false;
+        }
+
+        entry_p += ImageToc::ENTRY_SIZE;
+        --left;
+        ++ix;
+    }
+
+    auto & last = mParameters.back();
+
+    if (toc.end() != last->getRecordOffset() + last->getRecordLength()) {
+        LOG("Image changed, rewrite it: end=%u", toc.end());
+        return false;
+    }
+
+    bool isWritten = false;
+
+    for (auto & parameter: mParameters) {
+
+        if (!parameter->isDirty()) {
+            continue;
+        }
+
+        ByteBuffer::iterator it = buffer.begin() + parameter->getRecordOffset();
+
+        parameter->write(it);
+        parameter->setRecord(parameter->getRecordOffset(), parameter->getRecordLength());
+
+        isWritten = true;
+    }
+
+    if (isWritten) {
+
+        if (toc.hasCrc()) {
+            ImageToc::writeCrc(buffer, toc.end());
+        }
+
+        buffer.commit();
+    }
+
+    return true;
+}
+
+Config& Config::write(RecordLog& log) {
+
+    bool isWritten = false;
+
+    for (auto & parameter: mParameters) {
+
+        if (!parameter->isDirty() && log.contains(parameter->getId())) {
+            continue;
+        }
+
+        parameter->decode();
+
+        if (!log.append(*parameter)) {
+            LOG("Log append failed: id=%d", parameter->getId());
+            continue;
+        }
+
+        /* Clean, but not placed in an image */
+        parameter->setRecord(ConfigParameterBase::NO_OFFSET, 0);
+        isWritten = true;
+    }
+
+    mImage_p = nullptr;
+
+    if (isWritten) {
+        log.commit();
+    }
+
+    return *this;
+}
+
+Config& Config::read(RecordLog& log) {
+
+    mUnpublished.set();
+
+    for (auto & parameter: mParameters) {
+
+        parameter->defer(nullptr);
+
+        if (log.load(*parameter)) {
+            parameter->setRecord(ConfigParameterBase::NO_OFFSET, 0);
+        } else {
+            parameter->touch();
+        }
+    }
+
+    mImage_p = nullptr;
+
+    return *this;
+}
+
+bool Config::touchPending(bool force) {
+
+    bool isDue = false;
+
+    for (auto & parameter: mParameters) {
+
+        if (parameter->getType() == ConfigParameterType::COUNTER) {
+            isDue = isDue || static_cast<ConfigParameter<PersistCounter>*>(parameter.get())->isFlushDue();
+        }
+    }
+
+    if (!isDue && !force) {
+        return false;
+    }
+
+    for (auto & parameter: mParameters) {
+
+        if ((parameter->getType() == ConfigParameterType::COUNTER) &&
+            static_cast<ConfigParameter<PersistCounter>*>(parameter.get())->pending()) {
+            parameter->touch();
+        }
+    }
+
+    return true;
+}
+
+bool Config::flush(ByteBuffer& buffer, bool force) {
+
+    if (!touchPending(force)) {
+        return false;
+    }
+
+    write(buffer);
+    return true;
+}
+
+bool Config::flush(RecordLog& log, bool force) {
+
+    if (!touchPending(force)) {
+        return false;
+    }
+
+    write(log);
+    return true;
+}
+
+void Config::touch(uint8_t id) {
+
+    ConfigParameterBase* parameter_p = find(id);
+
+    if (parameter_p) {
+        parameter_p->touch();
+        changed(id);
+    }
+}
+
+std::function<void(uint8_t id)> Config::onChange(std::function<void(uint8_t id)> listener) {
+
+    std::swap(mListener, listener);
+
+    return listener;
+}
+
+void Config::changed(uint8_t id) {
+
+    mUnpublished.set(id);
+
+    if (mListener) {
+        mListener(id);
+    }
+}
+
+Config::SnapshotRef Config::snapshot() const {
+
+    Reader* reader_p = nullptr;
+
+    while (true) {
+
+        for (auto & reader: mReaders) {
+            if (!reader.claimed.load(std::memory_order_relaxed) &&
+                !reader.claimed.exchange(true, std::memory_order_acquire)) {
+                reader_p = &reader;
+                break;
+            }
+        }
+
+        if (reader_p) {
+            break;
+        }
+
+        /* All slots held: let their readers run and release one */
+        yield();
+    }
+
+    /* Still current once in the slot: publish() sees the slot before it
+     * frees the snapshot. Otherwise retry with the new one. */
+    const Snapshot* snapshot_p = mSnapshot_p.load();
+
+    while (true) {
+
+        reader_p->snapshot_p.store(snapshot_p);
+
+        const Snapshot* current_p = mSnapshot_p.load();
+
+        if (current_p == snapshot_p) {
+            break;
+        }
+
+        snapshot_p = current_p;
+    }
+
+    return SnapshotRef(reader_p, snapshot_p);
+}
+
+void Config::reclaim() {
+
+    auto isHeld = [this](const Snapshot* snapshot_p) {
+        for (auto & reader: mReaders) {
+            if (reader.snapshot_p.load() == snapshot_p) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    auto end = std::remove_if(mRetired.begin(), mRetired.end(), [&isHeld](const Snapshot* snapshot_p) {
+        if (isHeld(snapshot_p)) {
+            return false;
+        }
+        delete snapshot_p;
+        return true;
+    });
+
+    mRetired.erase(end, mRetired.end());
+}
+
+void Config::publish() {
+
+    const Snapshot* previous_p = mSnapshot_p.load(std::memory_order_relaxed);
+    Snapshot* next_p = new Snapshot();
+
+    next_p->mVersion = previous_p ? previous_p->mVersion + 1 : 1;
+    next_p->mIndex = mIndex;
+    next_p->mParameters.reserve(mParameters.size());
+
+    for (auto & parameter: mParameters) {
+
+        unsigned char id = parameter->getId();
+
+        if (!mUnpublished[id] && previous_p && (previous_p->mIndex[id] != NO_INDEX)) {
+            next_p->mParameters.push_back(previous_p->mParameters[previous_p->mIndex[id]]);
+            continue;
+        }
+
+        /* Readers must not decode from the writer's buffer */
+        parameter->decode();
+        next_p->mParameters.push_back(parameter->clone());
+    }
+
+    for (auto & mirror: mMirrors) {
+        if (mUnpublished[mirror.id]) {
+            mirror.update();
+        }
+    }
+
+    mUnpublished.reset();
+
+    mSnapshot_p.store(next_p);
+
+    if (previous_p) {
+        mRetired.push_back(previous_p);
+    }
+
+    reclaim();
+}
+
+// Class Config::SnapshotRef
+
+Config::SnapshotRef::SnapshotRef(SnapshotRef&& other)
+    : mReader_p(other.mReader_p), mSnapshot_p(other.mSnapshot_p) {
+
+    other.mReader_p = nullptr;
+    other.mSnapshot_p = nullptr;
+}
+
+Config::SnapshotRef& Config::SnapshotRef::operator= (SnapshotRef&& other) {
+
+    if (this != &other) {
+
+        release();
+
+        mReader_p = other.mReader_p;
+        mSnapshot_p = other.mSnapshot_p;
+
+        other.mReader_p = nullptr;
+        other.mSnapshot_p = nullptr;
+    }
+
+    return *this;
+}
+
+Config::SnapshotRef::~SnapshotRef() {
+
+    release();
+}
+
+void Config::SnapshotRef::release() {
+
+    if (mReader_p) {
+        mReader_p->snapshot_p.store(nullptr, std::memory_order_release);
+        mReader_p->claimed.store(false, std::memory_order_release);
+        mReader_p = nullptr;
+    }
+}
+
+Config& Config::read(ByteBuffer& buffer, Decode decode) {
+
+    ImageToc toc(buffer);
+
+    mUnpublished.set();
+
+    for (auto & parameter: mParameters) {
+        parameter->defer(nullptr);
+    }
+
+    if (!toc.isValid()) {
+        /* Converted by the next write */
+        mImage_p = nullptr;
+        return readLegacy(buffer);
+    }
+
+    /* One pass over the image instead of a check per record */
+    bool isIntact = toc.isIntact();
+
+    ImageToc::Entry entry;
+    unsigned char placed = 0;
+
+    for (unsigned char ix = 0; ix < toc.count(); ++ix) {
+
+        if (!toc.entry(ix, entry)) {
+            continue;
+        }
+
+        ConfigParameterBase* parameter_p = find(entry.id);
+
+        if (!parameter_p) {
+            LOG("Skip unknown parameter: id=%d", entry.id);
+            continue;
+        }
+
+        ++placed;
+
+        parameter_p->setRecord(entry.offset, entry.length);
+        parameter_p->setVerified(isIntact);
+
+        if (decode == Decode::LAZY) {
+            parameter_p->defer(&buffer, entry.offset);
+            continue;
+        }
+
+        ByteBuffer::iterator it = buffer.begin() + entry.offset;
+
+        if (parameter_p->read(it) == it) {
+            /* Repaired by the next write */
+            parameter_p->touch();
+        }
+
+        parameter_p->setVerified(false);
+    }
+
+    /* Records are rewritten in place only if each parameter has one */
+    mImage_p = (placed == mParameters.size()) ? &buffer : nullptr;
+
+    return *this;
+}
+
+Config& Config::readLegacy(ByteBuffer& buffer) {
 
     ByteBuffer::iterator it = buffer.begin();
 
-    for (auto & [ key, parameter]: mParameters) {
+    for (auto & parameter: mParameters) {
 
         if (!it.isValid()) {
             break;
@@ -55,3 +543,61 @@ Config& Config::read(ByteBuffer& buffer) {
 
     return *this;
 }
+
+bool Config::load(ByteBuffer& buffer, uint8_t id) {
+
+    ConfigParameterBase* parameter_p = find(id);
+
+    if (!parameter_p) {
+        return false;
+    }
+
+    parameter_p->defer(nullptr);
+    mUnpublished.set(id);
+
+    ImageToc toc(buffer);
+    ByteBuffer::iterator it = buffer.begin();
+
+    if (toc.isValid()) {
+
+        ImageToc::Entry entry;
+
+        if (!toc.find(id, entry)) {
+            return false;
+        }
+
+        it += entry.offset;
+
+        if (parameter_p->read(it) == it) {
+            return false;
+        }
+
+        if (&buffer == mImage_p) {
+            parameter_p->setRecord(entry.offset, entry.length);
+        } else {
+            /* Not in the image the next write() updates in place */
+            parameter_p->touch();
+        }
+
+        return true;
+    }
+
+    /* Legacy image: the records before it have to be parsed */
+    for (auto & parameter: mParameters) {
+
+        auto nextIt = parameter->read(it);
+
+        if (parameter.get() == parameter_p) {
+
+            if ((nextIt != it) && (&buffer != mImage_p)) {
+                parameter_p->touch();
+            }
+
+            return nextIt != it;
+        }
+
+        it = nextIt;
+    }
+
+    return false;
+}
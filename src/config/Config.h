@@ -9,13 +9,18 @@
 
 #pragma once
 
-#include <map>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <functional>
 #include <memory>
+#include <vector>
 #include <Arduino.h>
-#include <checksum.h>
 
 #include "ConfigParameter.h"
 #include "ByteBuffer.h"
+#include "RecordLog.h"
+#include "SeqLock.h"
 #include "StorageEeprom.h"
 
 namespace config {
@@ -23,12 +28,22 @@ namespace config {
 class Config {
 private:
     Config();
-    ~Config() = default;
+    ~Config();
 
     Config(Config const&) = delete;
     Config& operator= (Config const&) = delete;
 
 public:
+    template<typename T>
+    class Handle;
+
+    class Snapshot;
+    class SnapshotRef;
+
+    /* EAGER decodes every record in read(), LAZY validates the image
+     * table and decodes each parameter on its first get() */
+    enum class Decode : unsigned char { EAGER, LAZY };
+
     static Config& getInstance() {
         static Config config;
         return config;
@@ -40,20 +55,229 @@ public:
     template<typename T>
     Config& add(unsigned char id, const T &value);
 
+    /* Typed access resolved once, invalid if id is not added or has
+     * another type */
+    template<typename T>
+    Handle<T> handle(uint8_t id);
+
     template<typename T>
     T& get(uint8_t id);
 
+    /* Read-only get(): the value is not marked to be written */
+    template<typename T>
+    const T& view(uint8_t id);
+
     template<typename T>
     bool set(uint8_t id, const T& value);
 
-    Config& read(ByteBuffer& buffer);
+    /* Image with a table of contents (see ImageToc): records of unknown
+     * ids are skipped, a bad record does not stop the others. Legacy
+     * images without the table are parsed in sequence, always eagerly.
+     * LAZY keeps references to buffer until the parameters are decoded. */
+    Config& read(ByteBuffer& buffer, Decode decode = Decode::EAGER);
+
+    /* Into the image of the last read()/write() of the same buffer only
+     * the dirty records are written, in place, if their size is unchanged,
+     * no parameter was added since and the table in the buffer still
+     * lists the records where they were. Anything else is a writeAll(). */
     Config& write(ByteBuffer& buffer);
+    Config& writeAll(ByteBuffer& buffer);
+
+    /* Images written from now on carry a CRC32 (see ImageToc), read()
+     * then checks the image in one pass instead of each record */
+    void setImageCrc(bool hasCrc);
+
+    /* RecordLog backend: read loads the newest record of each parameter,
+     * write appends the dirty parameters and those not in the log yet */
+    Config& read(RecordLog& log);
+    Config& write(RecordLog& log);
+
+    /* write() with the counters which have pending counts, once the flush
+     * policy of one of them is due; call it from the loop or after the
+     * increments. force writes regardless of the policies, for shutdown
+     * and brownout hooks. true if it wrote. */
+    bool flush(ByteBuffer& buffer, bool force = false);
+    bool flush(RecordLog& log, bool force = false);
+
+    /* Marks id to be written, for values changed behind get() references
+     * which were obtained before the last write */
+    void touch(uint8_t id);
+
+    /* Called with the id after set(), Handle::set() and touch(), e.g. by
+     * a CommitScheduler. One listener: returns the one it replaces, for
+     * the new one to chain to and to put back later. An empty one
+     * removes it. */
+    std::function<void(uint8_t id)> onChange(std::function<void(uint8_t id)> listener);
+
+    /* Reads parameter id only, seeking to its record (legacy images
+     * decode the records before it as well). false if it is not added,
+     * not in the image or the record is invalid. */
+    bool load(ByteBuffer& buffer, uint8_t id);
+
+    /* Readers on other threads use the published state only and never
+     * see a publish in progress. Everything else, publish() included,
+     * belongs to the writer. The mirrors never block; snapshot() takes no
+     * lock either, but each live SnapshotRef holds one of READERS reader
+     * slots (64 on the host, 4 on the device). With all of them held,
+     * snapshot() yields until another thread releases one: a thread must
+     * not hold READERS references itself. */
+
+    /* Last published parameter set, immutable while the reference lives */
+    SnapshotRef snapshot() const;
+
+    /* Publishes the changes since the last publish at once: a new snapshot
+     * shares the copies of the unchanged parameters with the previous one.
+     * Values changed behind get() references need a touch() first.
+     * Replaced snapshots are freed once no reader holds them. */
+    void publish();
+
+    /* Value of id updated by each publish(), for scalars read at high
+     * rates. nullptr if id is not added or has another type. */
+    template<typename T>
+    const SeqLock<T>* mirror(uint8_t id);
 
 public:
     enum ID : unsigned char;
 
 private:
-    std::map<uint8_t, std::shared_ptr<ConfigParameterBase>> mParameters;
+    static constexpr unsigned char NO_INDEX = ConfigParameterBase::INVALID_ID;
+
+    void insert(std::shared_ptr<ConfigParameterBase> parameter);
+    Config& readLegacy(ByteBuffer& buffer);
+    bool writeDirty(ByteBuffer& buffer);
+    /* Touches the counters with pending counts if a flush is due or
+     * forced, false otherwise */
+    bool touchPending(bool force);
+    ConfigParameterBase* find(uint8_t id);
+    void changed(uint8_t id);
+
+    /* Frees the retired snapshots no reader holds */
+    void reclaim();
+
+    /* Parameter id if it holds a T, nullptr otherwise */
+    template<typename T>
+    ConfigParameter<T>* find(uint8_t id);
+
+private:
+    /* Sorted by id, the image keeps the order of the ids */
+    std::vector<std::shared_ptr<ConfigParameterBase>> mParameters;
+
+    /* id -> position in mParameters, NO_INDEX if not added */
+    std::array<unsigned char, 256> mIndex;
+
+    /* Buffer the record offsets of the parameters refer to, nullptr if
+     * the next write has to lay out the whole image */
+    ByteBuffer* mImage_p;
+
+    bool mHasImageCrc;
+
+    std::function<void(uint8_t id)> mListener;
+
+    struct Mirror {
+        uint8_t id;
+        std::shared_ptr<void> lock_p;
+        std::function<void()> update;
+    };
+
+#if CONFIG_PLATFORM_HOST
+    static constexpr unsigned char READERS = 64;
+    static constexpr size_t READER_ALIGN = 64;  /* cache line */
+#else
+    static constexpr unsigned char READERS = 4;
+    static constexpr size_t READER_ALIGN = alignof(void*);
+#endif
+
+    /* Hazard slot: the snapshot a reader holds is not freed. A reader
+     * claims a slot, stores the snapshot it loaded and loads again; once
+     * both match, publish() sees the snapshot in the slot. */
+    struct alignas(READER_ALIGN) Reader {
+        std::atomic<bool> claimed;
+        std::atomic<const Snapshot*> snapshot_p;
+    };
+
+    /* Parameters changed since the last publish */
+    std::bitset<256> mUnpublished;
+    std::atomic<const Snapshot*> mSnapshot_p;
+    std::vector<const Snapshot*> mRetired;
+    mutable std::array<Reader, READERS> mReaders;
+    std::vector<Mirror> mMirrors;
+};
+
+template<typename T>
+class Config::Handle {
+public:
+    Handle() : mParameter_p(nullptr) {}
+
+    bool isValid() const { return mParameter_p != nullptr; }
+    explicit operator bool() const { return isValid(); }
+
+    T& get() const { return mParameter_p->get(); }
+    const T& view() const { return mParameter_p->view(); }
+    void set(const T& value) const {
+        mParameter_p->set(value);
+        Config::getInstance().changed(mParameter_p->getId());
+    }
+
+    T& operator*() const { return get(); }
+    T* operator->() const { return &get(); }
+
+private:
+    friend class Config;
+
+    explicit Handle(ConfigParameter<T>* parameter_p) : mParameter_p(parameter_p) {}
+
+private:
+    ConfigParameter<T>* mParameter_p;
+};
+
+/* Values of the parameters at one publish() */
+class Config::Snapshot {
+public:
+    Snapshot() : mVersion(0) { mIndex.fill(NO_INDEX); }
+
+    /* Increases with each publish() */
+    unsigned long version() const { return mVersion; }
+
+    /* Value of id, nullptr if it is not added or has another type */
+    template<typename T>
+    const T* find(uint8_t id) const;
+
+    template<typename T>
+    T get(uint8_t id, const T& fallback = T()) const;
+
+private:
+    friend class Config;
+
+    unsigned long mVersion;
+    std::vector<std::shared_ptr<ConfigParameterBase>> mParameters;
+    std::array<unsigned char, 256> mIndex;
+};
+
+/* Snapshot held by a reader, the slot is released on destruction */
+class Config::SnapshotRef {
+public:
+    SnapshotRef(SnapshotRef&& other);
+    SnapshotRef& operator= (SnapshotRef&& other);
+    ~SnapshotRef();
+
+    SnapshotRef(SnapshotRef const&) = delete;
+    SnapshotRef& operator= (SnapshotRef const&) = delete;
+
+    const Snapshot* get() const { return mSnapshot_p; }
+    const Snapshot& operator*() const { return *mSnapshot_p; }
+    const Snapshot* operator->() const { return mSnapshot_p; }
+
+private:
+    friend class Config;
+
+    SnapshotRef(Reader* reader_p, const Snapshot* snapshot_p)
+        : mReader_p(reader_p), mSnapshot_p(snapshot_p) {}
+
+    void release();
+
+private:
+    Reader* mReader_p;
+    const Snapshot* mSnapshot_p;
 };
 
 enum Config::ID : unsigned char
@@ -79,12 +303,17 @@ enum Config::ID : unsigned char
     CUSTOM_START = CUSTOM_MASK,
 };
 
+inline ConfigParameterBase* Config::find(uint8_t id) {
+
+    unsigned char position = mIndex[id];
+
+    return (position != NO_INDEX) ? mParameters[position].get() : nullptr;
+}
+
 template<typename T>
 Config& Config::add(ConfigParameter<T>* parameter_p) {
 
-    mParameters.insert(std::pair<uint8_t, std::shared_ptr<ConfigParameterBase>>(
-        parameter_p->getId(),
-        std::make_shared<ConfigParameter<T>>(*parameter_p)));
+    insert(std::make_shared<ConfigParameter<T>>(*parameter_p));
 
     return *this;
 }
@@ -92,39 +321,141 @@ Config& Config::add(ConfigParameter<T>* parameter_p) {
 template<typename T>
 Config& Config::add(unsigned char id, const T &value) {
 
-    add<T>(new ConfigParameter<T>(id, value));
+    insert(std::make_shared<ConfigParameter<T>>(id, value));
     return *this;
 }
 
+template<typename T>
+ConfigParameter<T>* Config::find(uint8_t id) {
+
+    static_assert(ConfigParameterTypeOf<T>::value != ConfigParameterType::INVALID,
+                  "Not a parameter type");
+
+    auto parameter_p = find(id);
+
+    if (parameter_p && parameter_p->holds<T>()) {
+        return static_cast<ConfigParameter<T>*>(parameter_p);
+    }
+
+    return nullptr;
+}
+
+template<typename T>
+Config::Handle<T> Config::handle(uint8_t id) {
+
+    auto parameter_p = find<T>(id);
+
+    if (!parameter_p) {
+        LOG("handle: not found %u", id);
+    }
+
+    return Handle<T>(parameter_p);
+}
+
 template<typename T>
 T& Config::get(uint8_t id) {
 
-    for (auto & [ _, parameter]: mParameters) {
+    auto parameter_p = find<T>(id);
 
-        if (parameter->getId() == id) {
-            LOG("get: found %u", id);
-            return std::static_pointer_cast<ConfigParameter<T>>(parameter)->get();
-        }
+    if (parameter_p) {
+        LOG("get: found %u", id);
+        return parameter_p->get();
     }
 
     LOG("get: not found %u", id);
-    return std::shared_ptr<ConfigParameter<T>>(new ConfigParameter<T>())->get();
+
+    // Default value, reset on every miss
+    static ConfigParameter<T> sMissing;
+    sMissing = ConfigParameter<T>();
+
+    return sMissing.get();
+}
+
+template<typename T>
+const T& Config::view(uint8_t id) {
+
+    auto parameter_p = find<T>(id);
+
+    if (parameter_p) {
+        return parameter_p->view();
+    }
+
+    LOG("view: not found %u", id);
+
+    // Default value, reset on every miss
+    static ConfigParameter<T> sMissing;
+    sMissing = ConfigParameter<T>();
+
+    return sMissing.view();
 }
 
 template<typename T>
 bool Config::set(uint8_t id, const T& value)
 {
-    for (auto & [ _, parameter]: mParameters)
+    auto parameter_p = find<T>(id);
+
+    if (parameter_p)
     {
-        if (parameter->getId() == id)
-        {
-            LOG("set: found: %u", id);
-            *std::static_pointer_cast<ConfigParameter<T>>(parameter) = value;
-            return true;
-        }
+        LOG("set: found: %u", id);
+        parameter_p->set(value);
+        changed(id);
+        return true;
     }
     LOG("set: not found %u", id);
     return false;
 }
 
+template<typename T>
+const SeqLock<T>* Config::mirror(uint8_t id) {
+
+    auto parameter_p = find<T>(id);
+
+    if (!parameter_p) {
+        LOG("mirror: not found %u", id);
+        return nullptr;
+    }
+
+    for (auto & mirror: mMirrors) {
+        if (mirror.id == id) {
+            return static_cast<const SeqLock<T>*>(mirror.lock_p.get());
+        }
+    }
+
+    parameter_p->decode();
+
+    auto lock_p = std::make_shared<SeqLock<T>>(parameter_p->mValue);
+
+    mMirrors.push_back({id, lock_p, [lock_p, parameter_p]() {
+        lock_p->store(parameter_p->mValue);
+    }});
+
+    return lock_p.get();
+}
+
+template<typename T>
+const T* Config::Snapshot::find(uint8_t id) const {
+
+    unsigned char position = mIndex[id];
+
+    if (position == NO_INDEX) {
+        return nullptr;
+    }
+
+    auto parameter_p = mParameters[position].get();
+
+    if (!parameter_p->holds<T>()) {
+        return nullptr;
+    }
+
+    return &static_cast<const ConfigParameter<T>*>(parameter_p)->mValue;
+}
+
+template<typename T>
+T Config::Snapshot::get(uint8_t id, const T& fallback) const {
+
+    auto value_p = find<T>(id);
+
+    return value_p ? *value_p : fallback;
+}
+
 } // namespace
@@ -7,28 +7,26 @@
  * (at your option) any later version.
  */
 
+#include <algorithm>
+#include <climits>
+#include <string.h>
 #include <vector>
 #include <console.h>
-#include <checksum.h>
 
 #include "PersistCounter.h"
 #include "ConfigParameter.h"
+#include "Crc.h"
 
 using namespace console;
-using namespace checksum;
 using namespace config;
 
 // Class ConfigParameterBase
 
 ConfigParameterBase::ConfigParameterBase(ConfigParameterType type, unsigned char id, bool isValid = false)
-    : mType(type), mId(id), mIsValid(isValid) {}
+    : mType(type), mId(id), mIsValid(isValid), mElement_p(nullptr), mSource_p(nullptr), mSourceOffset(0),
+      mIsDirty(true), mIsVerified(false), mRecordOffset(NO_OFFSET), mRecordLength(0) {}
 
-unsigned char ConfigParameterBase::getId() {
-
-    return this->mId;
-}
-
-ConfigParameterType ConfigParameterBase::getType() {
+ConfigParameterType ConfigParameterBase::getType() const {
 
     return this->mType;
 }
@@ -38,12 +36,62 @@ bool ConfigParameterBase::isValid() {
     return mIsValid;
 }
 
+void ConfigParameterBase::defer(ByteBuffer* buffer_p, unsigned short offset) {
+
+    mSource_p = buffer_p;
+    mSourceOffset = offset;
+
+    if (!buffer_p) {
+        mIsVerified = false;
+    }
+}
+
+unsigned short ConfigParameterBase::recordSize() {
+
+    return HEADER_SIZE;
+}
+
+void ConfigParameterBase::setRecord(unsigned short offset, unsigned short length) {
+
+    mRecordOffset = offset;
+    mRecordLength = length;
+    mIsDirty = false;
+}
+
+void ConfigParameterBase::access() {
+
+    decode();
+
+    mIsDirty = true;
+}
+
+bool ConfigParameterBase::decode() {
+
+    if (!mSource_p) {
+        return true;
+    }
+
+    ByteBuffer::iterator it = mSource_p->begin() + mSourceOffset;
+
+    /* A record which does not match is not tried again */
+    mSource_p = nullptr;
+
+    bool isRead = read(it) != it;
+    mIsVerified = false;
+
+    return isRead;
+}
+
 ByteBuffer::iterator ConfigParameterBase::read(ByteBuffer::iterator &it) {
 
-    ByteBuffer::iterator nextIt = it;
+    unsigned char header[HEADER_SIZE];
+
+    if (it.mBuffer_p->read(it, reinterpret_cast<char *>(header), HEADER_SIZE) != HEADER_SIZE) {
+        return it;
+    }
 
-    char id = *nextIt++;
-    char type = *nextIt++;
+    unsigned char id = header[0];
+    char type = header[1];
 
     if (id != mId) {
         LOG("Skip parameter: id=%d (!= %d)", mId, id);
@@ -55,17 +103,208 @@ ByteBuffer::iterator ConfigParameterBase::read(ByteBuffer::iterator &it) {
         return it;
     }
 
-    return nextIt;
+    return it + HEADER_SIZE;
 }
 
 ByteBuffer::iterator ConfigParameterBase::write(ByteBuffer::iterator &it) {
 
-    ByteBuffer::iterator nextIt = it;
-
     /* LOG("write: id=0x%x, type=0x%x", mId, mType); */
 
-    *nextIt++ = static_cast<char>(mId);
-    *nextIt++ = static_cast<char>(mType);
+    const char header[HEADER_SIZE] = { static_cast<char>(mId), static_cast<char>(mType) };
+
+    it.mBuffer_p->write(it, header, HEADER_SIZE);
+
+    return it + HEADER_SIZE;
+}
+
+ByteBuffer::iterator ConfigParameterBase::readRecord(ByteBuffer::iterator &it,
+                                                     unsigned char id, ConfigParameterType type,
+                                                     char *payload_p, unsigned char length, bool isVerified) {
+
+    char buffer[HEADER_SIZE + UCHAR_MAX + 1];
+    unsigned short size = HEADER_SIZE + length + 1;
+
+    if (it.mBuffer_p->remaining(it) < size) {
+        return it;
+    }
+
+    /* Parse contiguous buffers in place */
+    const char *record = it.data();
+
+    if (!record) {
+        it.mBuffer_p->read(it, buffer, size);
+        record = buffer;
+    }
+
+    if (static_cast<unsigned char>(record[0]) != id) {
+        LOG("Skip parameter: id=%d (!= %d)", id, record[0]);
+        return it;
+    }
+
+    if (record[1] != static_cast<char>(type)) {
+        LOG("Skip parameter: id=%d, type=%d (!= %d)", id, type, record[1]);
+        return it;
+    }
+
+    if (!isVerified && (static_cast<char>(crc8(record + HEADER_SIZE, length)) != record[HEADER_SIZE + length])) {
+
+        LOG("Invalid checksum (0x%X): id=%d, type=%d", record[HEADER_SIZE + length], id, type);
+        return it;
+    }
+
+    memcpy(payload_p, record + HEADER_SIZE, length);
+
+    return it + size;
+}
+
+ByteBuffer::iterator ConfigParameterBase::writeRecord(ByteBuffer::iterator &it,
+                                                      unsigned char id, ConfigParameterType type,
+                                                      const char *payload_p, unsigned char length) {
+
+    char record[HEADER_SIZE + UCHAR_MAX + 1];
+    unsigned short size = HEADER_SIZE + length + 1;
+
+    record[0] = static_cast<char>(id);
+    record[1] = static_cast<char>(type);
+
+    memcpy(record + HEADER_SIZE, payload_p, length);
+
+    record[HEADER_SIZE + length] = crc8(payload_p, length);
+
+    it.mBuffer_p->write(it, record, size);
+
+    return it + size;
+}
+
+ByteBuffer::iterator ConfigParameterBase::readBytes(ByteBuffer::iterator &it,
+                                                    unsigned char id, ConfigParameterType type,
+                                                    char *buffer_p, const char *&bytes_p, unsigned char &length,
+                                                    bool isVerified) {
+
+    if (it.mBuffer_p->remaining(it) < HEADER_SIZE + 2) {
+        return it;
+    }
+
+    /* Parse contiguous buffers in place */
+    const char *record = it.data();
+
+    if (!record) {
+        it.mBuffer_p->read(it, buffer_p, HEADER_SIZE + 1);
+        record = buffer_p;
+    }
+
+    if (static_cast<unsigned char>(record[0]) != id) {
+        LOG("Skip parameter: id=%d (!= %d)", id, record[0]);
+        return it;
+    }
+
+    if (record[1] != static_cast<char>(type)) {
+        LOG("Skip parameter: id=%d, type=%d (!= %d)", id, type, record[1]);
+        return it;
+    }
+
+    unsigned char count = record[HEADER_SIZE];
+    unsigned short size = HEADER_SIZE + 1 + count + 1;
+
+    if (it.mBuffer_p->remaining(it) < size) {
+        return it;
+    }
+
+    if (record == buffer_p) {
+        it.mBuffer_p->read(it, buffer_p, size);
+    }
+
+    const char *data = record + HEADER_SIZE + 1;
+
+    if (!isVerified && (static_cast<char>(crc8(data, count)) != data[count])) {
+
+        LOG("Invalid checksum (0x%X): id=%d, type=%d", data[count], id, type);
+        return it;
+    }
+
+    bytes_p = data;
+    length = count;
+
+    return it + size;
+}
+
+ByteBuffer::iterator ConfigParameterBase::writeBytes(ByteBuffer::iterator &it,
+                                                     unsigned char id, ConfigParameterType type,
+                                                     const char *bytes_p, unsigned char length) {
+
+    char record[BYTES_RECORD_MAX];
+    unsigned short size = HEADER_SIZE + 1 + length + 1;
+
+    record[0] = static_cast<char>(id);
+    record[1] = static_cast<char>(type);
+    record[HEADER_SIZE] = static_cast<char>(length);
+
+    memcpy(record + HEADER_SIZE + 1, bytes_p, length);
+
+    record[HEADER_SIZE + 1 + length] = crc8(bytes_p, length);
+
+    it.mBuffer_p->write(it, record, size);
+
+    return it + size;
+}
+
+ByteBuffer::iterator ConfigParameterBase::readCounter(ByteBuffer::iterator &it, unsigned char id,
+                                                      PersistCounter &counter, bool isVerified) {
+
+    char header[HEADER_SIZE];
+
+    if (it.mBuffer_p->read(it, header, HEADER_SIZE) != HEADER_SIZE) {
+        return it;
+    }
+
+    if (static_cast<unsigned char>(header[0]) != id) {
+        LOG("Skip parameter: id=%d (!= %d)", id, header[0]);
+        return it;
+    }
+
+    if (header[1] != static_cast<char>(ConfigParameterType::COUNTER)) {
+        LOG("Skip parameter: id=%d, type=%d (!= %d)", id, ConfigParameterType::COUNTER, header[1]);
+        return it;
+    }
+
+    auto recordIt = it + HEADER_SIZE;
+    auto nextIt = counter.read(recordIt);
+
+    if (nextIt == recordIt) {
+        LOG("Invalid counter: id=%d", id);
+        return it;
+    }
+
+    /* Slots carry their CRC8. The checksum is written after the slot, a
+     * reset between the two leaves it behind the value. */
+    bool isChecked = counter.isHome(recordIt);
+
+    char checksum = nextIt.mBuffer_p->read<char>(nextIt);
+    ++nextIt;
+
+    if (!isVerified && !isChecked &&
+        (static_cast<char>(crc8(reinterpret_cast<const char *>(&counter.get()), sizeof(PersistCounter::Type))) != checksum)) {
+
+        LOG("Invalid checksum 0x%x: id=%d, type=%d", checksum, id, ConfigParameterType::COUNTER);
+        return it;
+    }
+
+    return nextIt;
+}
+
+ByteBuffer::iterator ConfigParameterBase::writeCounter(ByteBuffer::iterator &it, unsigned char id,
+                                                       PersistCounter &counter) {
+
+    const char header[HEADER_SIZE] = { static_cast<char>(id), static_cast<char>(ConfigParameterType::COUNTER) };
+
+    it.mBuffer_p->write(it, header, HEADER_SIZE);
+
+    auto nextIt = it + HEADER_SIZE;
+    nextIt = counter.write(nextIt);
+
+    nextIt.mBuffer_p->write<char>(nextIt, crc8(reinterpret_cast<const char *>(&counter.get()),
+                                               sizeof(PersistCounter::Type)));
+    ++nextIt;
 
     return nextIt;
 }
@@ -85,25 +324,22 @@ ConfigParameter<char>::ConfigParameter(unsigned char id, const char &value)
 {};
 
 template <>
-ByteBuffer::iterator ConfigParameter<char>::read(ByteBuffer::iterator &it) {
-
-    auto nextIt = ConfigParameterBase::read(it);
+unsigned short ConfigParameter<char>::recordSize() {
 
-    if (nextIt != it) {
+    return HEADER_SIZE + sizeof(char) + 1;
+}
 
-        mValue = *nextIt++;
+template <>
+ByteBuffer::iterator ConfigParameter<char>::read(ByteBuffer::iterator &it) {
 
-        char checksum = Checksum(Checksum::CRC8)
-            .calculate(reinterpret_cast<char *>(&mValue), sizeof(char));
+    char value;
+    auto nextIt = readRecord(it, &value, sizeof(char));
 
-        if (checksum != *nextIt++) {
+    if (nextIt != it) {
 
-            LOG("Invalid checksum (0x%X): id=%d, type=%d",
-                        checksum, mId, mType);
-            return it;
-        }
+        mValue = value;
 
-        LOG("CFG read [%02d]: %d, CS: 0x%X", mId, mValue, checksum);
+        LOG("CFG read [%02d]: %d", mId, mValue);
     }
 
     return nextIt;
@@ -112,15 +348,9 @@ ByteBuffer::iterator ConfigParameter<char>::read(ByteBuffer::iterator &it) {
 template <>
 ByteBuffer::iterator ConfigParameter<char>::write(ByteBuffer::iterator &it) {
 
-    auto nextIt = ConfigParameterBase::write(it);
-
-    char checksum = Checksum(Checksum::CRC8)
-        .calculate(reinterpret_cast<char *>(&mValue), sizeof(char));
-
-    *nextIt++ = mValue;
-    *nextIt++ = checksum;
+    auto nextIt = writeRecord(it, &mValue, sizeof(char));
 
-    LOG("CFG write [%02d]: %d, CS: 0x%X", mId, mValue, checksum);
+    LOG("CFG write [%02d]: %d", mId, mValue);
 
     return nextIt;
 }
@@ -139,10 +369,17 @@ ConfigParameter<int>::ConfigParameter(unsigned char id, const int &value)
     ConfigParameterValue(value)
 {};
 
+template <>
+unsigned short ConfigParameter<int>::recordSize() {
+
+    return HEADER_SIZE + sizeof(int) + 1;
+}
+
 template <>
 ByteBuffer::iterator ConfigParameter<int>::read(ByteBuffer::iterator &it) {
 
-    auto nextIt = ConfigParameterBase::read(it);
+    char payload[sizeof(int)];
+    auto nextIt = readRecord(it, payload, sizeof(payload));
 
     if (nextIt != it) {
 
@@ -150,20 +387,10 @@ ByteBuffer::iterator ConfigParameter<int>::read(ByteBuffer::iterator &it) {
 
         for (unsigned char ix = 0; ix < sizeof(int); ++ix) {
 
-            mValue |= BYTE_SET(ix, 0x00, *nextIt++);
-        }
-
-        char checksum = Checksum(Checksum::CRC8)
-            .calculate(reinterpret_cast<char *>(&mValue),sizeof(int));
-
-        if (checksum != *nextIt++) {
-
-            LOG("Invalid checksum (0x%X): id=%d, type=%d",
-                        checksum, mId, mType);
-            return it;
+            mValue |= BYTE_SET(ix, 0x00, payload[ix]);
         }
 
-        LOG("CFG read [%02d]: %d, CS: 0x%X", mId, mValue, checksum);
+        LOG("CFG read [%02d]: %d", mId, mValue);
     }
 
     return nextIt;
@@ -172,19 +399,16 @@ ByteBuffer::iterator ConfigParameter<int>::read(ByteBuffer::iterator &it) {
 template <>
 ByteBuffer::iterator ConfigParameter<int>::write(ByteBuffer::iterator &it) {
 
-    auto nextIt = ConfigParameterBase::write(it);
-
-    char checksum = Checksum(Checksum::CRC8)
-        .calculate(reinterpret_cast<char*>(&mValue), sizeof(int));
+    char payload[sizeof(int)];
 
     for (unsigned char ix = 0; ix < sizeof(int); ++ix) {
 
-        *nextIt++ = NBYTE(ix, mValue);
+        payload[ix] = NBYTE(ix, mValue);
     }
 
-    *nextIt++ = checksum;
+    auto nextIt = writeRecord(it, payload, sizeof(payload));
 
-    LOG("CFG write [%02d]: %d, CS: 0x%X", mId, mValue, checksum);
+    LOG("CFG write [%02d]: %d", mId, mValue);
 
     return nextIt;
 }
@@ -205,33 +429,27 @@ ConfigParameter<std::string>::ConfigParameter(unsigned char id,
 {};
 
 template <>
-ByteBuffer::iterator
-ConfigParameter<std::string>::read(ByteBuffer::iterator &it) {
-
-    auto nextIt = ConfigParameterBase::read(it);
+unsigned short ConfigParameter<std::string>::recordSize() {
 
-    if (nextIt != it) {
-
-        char length = *nextIt++;
-
-        mValue.clear();
+    /* id, type, length, value, checksum */
+    return HEADER_SIZE + 1 + std::min<size_t>(mValue.length(), UCHAR_MAX) + 1;
+}
 
-        for (unsigned char ix = 0; ix < length; ++ix) {
+template <>
+ByteBuffer::iterator
+ConfigParameter<std::string>::read(ByteBuffer::iterator &it) {
 
-            mValue += *nextIt++;
-        }
+    char buffer[BYTES_RECORD_MAX];
+    const char *data = nullptr;
+    unsigned char length = 0;
 
-        char checksum = Checksum(Checksum::CRC8)
-            .calculate(mValue.c_str(), mValue.length());
+    auto nextIt = readBytes(it, mId, mType, buffer, data, length, mIsVerified);
 
-        if (checksum != *nextIt++) {
+    if (nextIt != it) {
 
-            LOG("Invalid checksum (0x%X): id=%d, type=%d",
-                        checksum, mId, mType);
-            return it;
-        }
+        mValue.assign(data, length);
 
-        LOG("CFG read [%02d]: '%s', CS: 0x%X", mId, mValue.c_str(), checksum);
+        LOG("CFG read [%02d]: '%s', CS: 0x%X", mId, mValue.c_str(), data[length]);
     }
 
     return nextIt;
@@ -241,21 +459,11 @@ template <>
 ByteBuffer::iterator
 ConfigParameter<std::string>::write(ByteBuffer::iterator &it) {
 
-    auto nextIt = ConfigParameterBase::write(it);
-
-    char checksum = Checksum(Checksum::CRC8)
-        .calculate(mValue.c_str(), mValue.length());
+    unsigned char length = std::min<size_t>(mValue.length(), UCHAR_MAX);
 
-    *nextIt++ = mValue.length();
+    auto nextIt = writeBytes(it, mId, mType, mValue.data(), length);
 
-    for (unsigned char ix = 0; ix < mValue.length(); ++ix) {
-
-        *nextIt++ = mValue[ix];
-    }
-
-    *nextIt++ = checksum;
-
-    LOG("CFG write [%02d]: '%s', CS: 0x%X", mId, mValue.c_str(), checksum);
+    LOG("CFG write [%02d]: '%s'", mId, mValue.c_str());
 
     return nextIt;
 }
@@ -275,11 +483,18 @@ ConfigParameter<IPAddress>::ConfigParameter(unsigned char id,
     ConfigParameterValue(value)
 {};
 
+template <>
+unsigned short ConfigParameter<IPAddress>::recordSize() {
+
+    return HEADER_SIZE + sizeof(int) + 1;
+}
+
 template <>
 ByteBuffer::iterator
 ConfigParameter<IPAddress>::read(ByteBuffer::iterator &it) {
 
-    auto nextIt = ConfigParameterBase::read(it);
+    char payload[sizeof(int)];
+    auto nextIt = readRecord(it, payload, sizeof(payload));
 
     if (nextIt != it) {
 
@@ -287,23 +502,12 @@ ConfigParameter<IPAddress>::read(ByteBuffer::iterator &it) {
 
         for (unsigned char ix = 0; ix < sizeof(int); ++ix)
         {
-            address |= BYTE_SET(ix, 0x00, *nextIt++);
-        }
-
-        char checksum = Checksum(Checksum::CRC8)
-            .calculate(reinterpret_cast<char*>(&address), sizeof(int));
-
-        if (checksum != static_cast<char>(*nextIt++)) {
-
-            LOG("Invalid checksum (0x%X): id=%d, type=%d",
-                        checksum, mId, mType);
-            return it;
+            address |= BYTE_SET(ix, 0x00, payload[ix]);
         }
 
         mValue = address;
 
-        LOG("CFG read [%02d]: %s, CS: 0x%X",
-                    mId, IPAddress(address).toString().c_str(), checksum);
+        LOG("CFG read [%02d]: %s", mId, IPAddress(address).toString().c_str());
     }
 
     return nextIt;
@@ -313,20 +517,17 @@ template <>
 ByteBuffer::iterator
 ConfigParameter<IPAddress>::write(ByteBuffer::iterator &it) {
 
-    auto nextIt = ConfigParameterBase::write(it);
+    char payload[sizeof(int)];
     unsigned int address = static_cast<unsigned int>(mValue);
 
     for (unsigned char ix = 0; ix < sizeof(int); ++ix) {
 
-        *nextIt++ = NBYTE(ix, address);
+        payload[ix] = NBYTE(ix, address);
     }
 
-    char checksum = Checksum(Checksum::CRC8)
-        .calculate(reinterpret_cast<char*>(&address), sizeof(int));
+    auto nextIt = writeRecord(it, payload, sizeof(payload));
 
-    *nextIt++ = checksum;
-    LOG("CFG write [%02d]: %s, CS: 0x%X",
-                mId, mValue.toString().c_str(), checksum);
+    LOG("CFG write [%02d]: %s", mId, mValue.toString().c_str());
 
     return nextIt;
 }
@@ -349,50 +550,36 @@ ConfigParameter<PersistCounter>::ConfigParameter(unsigned char id, const Persist
 
 ConfigParameter<PersistCounter>::operator PersistCounter()
 {
-    return mValue;
+    return get();
 }
 
 PersistCounter &ConfigParameter<PersistCounter>::operator=(const PersistCounter &value)
 {
-    this->mValue = value;
+    set(value);
     return this->mValue;
 }
 
-ByteBuffer::iterator ConfigParameter<PersistCounter>::read(ByteBuffer::iterator &it)
+unsigned short ConfigParameter<PersistCounter>::recordSize()
 {
-    auto nextIt = ConfigParameterBase::read(it);
-
-    nextIt = mValue.read(nextIt);
-
-    char checksum = *nextIt++;
-    char valid = Checksum(Checksum::CRC8)
-                     .calculate(reinterpret_cast<const char *>(&mValue.get()),
-                                sizeof(PersistCounter::Type));
-    if (checksum != valid)
-    {
-        LOG("Invalid checksum 0x%x (!= 0x%x): id=%d, type=%d",
-            checksum, valid, mId, mType);
-        return it;
-    }
-
-    LOG("CFG read [%02d]: %d, CS: 0x%X", mId, mValue.get(), checksum);
-
-    return nextIt;
+    return HEADER_SIZE + mValue.recordSize() + 1;
 }
 
-ByteBuffer::iterator ConfigParameter<PersistCounter>::write(ByteBuffer::iterator &it)
+ByteBuffer::iterator ConfigParameter<PersistCounter>::read(ByteBuffer::iterator& it)
 {
-    auto nextIt = ConfigParameterBase::write(it);
+    auto nextIt = readCounter(it, mId, mValue, mIsVerified);
 
-    nextIt = mValue.write(nextIt);
+    if (nextIt != it) {
+        LOG("CFG read [%02d]: %d", mId, mValue.get());
+    }
 
-    char checksum = Checksum(Checksum::CRC8)
-        .calculate(reinterpret_cast<const char*>(&mValue.get()),
-                   sizeof(PersistCounter::Type));
+    return nextIt;
+}
 
-    *nextIt++ = checksum;
+ByteBuffer::iterator ConfigParameter<PersistCounter>::write(ByteBuffer::iterator& it)
+{
+    auto nextIt = writeCounter(it, mId, mValue);
 
-    LOG("CFG write [%02d]: %u, CS: 0x%X", mId, mValue.get(), checksum);
+    LOG("CFG write [%02d]: %u", mId, mValue.get());
 
     return nextIt;
 }
@@ -9,15 +9,21 @@
 
 #pragma once
 
+#include <algorithm>
+#include <climits>
+#include <stdint.h>
+#include <string.h>
+#include <string>
 #include <type_traits>
 #include <vector>
 #include <memory>
 #include <Arduino.h>
 #include <IPAddress.h>
 #include <console.h>
-#include <checksum.h>
+#include <macros/byte.h>
 
 #include "ByteBuffer.h"
+#include "Crc.h"
 #include "PersistCounter.h"
 
 namespace config {
@@ -39,23 +45,179 @@ public:
     ConfigParameterBase(ConfigParameterType type, unsigned char id, bool isValid);
     virtual ~ConfigParameterBase() {}
 
-    unsigned char getId();
-    ConfigParameterType getType();
+    unsigned char getId() const { return mId; }
+    ConfigParameterType getType() const;
 
     bool isValid();
 
+    /* Holds a ConfigParameter<T>: the type tag and, for arrays, the
+     * element type match */
+    template <typename T>
+    bool holds() const;
+
     virtual ByteBuffer::iterator read(ByteBuffer::iterator& it);
     virtual ByteBuffer::iterator write(ByteBuffer::iterator& it);
 
+    /* Copy of the parameter, a deferred one stays deferred */
+    virtual std::shared_ptr<ConfigParameterBase> clone() const = 0;
+
+    /* Lazy decode: the record at offset of buffer is read on the first
+     * get(), set() drops it. The buffer must outlive the parameter or the
+     * next defer/decode. nullptr cancels a deferred record and clears
+     * setVerified. */
+    void defer(ByteBuffer* buffer_p, unsigned short offset = 0);
+    bool isDeferred() const { return mSource_p != nullptr; }
+
+    /* Reads a deferred record now, false if it does not match */
+    bool decode();
+
+    /* The next read or decode skips the record checksum, the image CRC32
+     * already covered it. Cleared by decode. */
+    void setVerified(bool isVerified) { mIsVerified = isVerified; }
+
+    /* First get() since the record was read or written: decodes a
+     * deferred record and marks the value dirty. A deferred parameter is
+     * never dirty, so get() only has to test the flag. */
+    void access();
+
+    /* Encoded size of the record for the current value */
+    virtual unsigned short recordSize();
+
+    /* Value changed since its record was last read or written. get()
+     * marks it as well, the value may be modified through the reference;
+     * view() is the read-only access which does not. */
+    bool isDirty() const { return mIsDirty; }
+    void touch() { mIsDirty = true; }
+
+    /* Position of the record in the image, NO_OFFSET if unknown. Setting
+     * it tells the record matches the value and clears the dirty flag. */
+    static constexpr unsigned short NO_OFFSET = 0xFFFF;
+
+    void setRecord(unsigned short offset, unsigned short length);
+    unsigned short getRecordOffset() const { return mRecordOffset; }
+    unsigned short getRecordLength() const { return mRecordLength; }
+
+    static constexpr unsigned char HEADER_SIZE = 2;  /* id, type */
+
+    /* Record codecs, shared with ArenaConfig. Each record is transferred
+     * as a single block, read returns it if the record does not match or
+     * the checksum is invalid; isVerified skips the checksum. */
+
+    /* Fixed size record: id, type, payload, CRC8 of payload */
+    static ByteBuffer::iterator readRecord(ByteBuffer::iterator& it, unsigned char id, ConfigParameterType type,
+                                           char* payload_p, unsigned char length, bool isVerified);
+    static ByteBuffer::iterator writeRecord(ByteBuffer::iterator& it, unsigned char id, ConfigParameterType type,
+                                            const char* payload_p, unsigned char length);
+
+    /* Strings and byte arrays: id, type, length, bytes, CRC8 of bytes.
+     * bytes_p is parsed in place for contiguous buffers, else it points
+     * into buffer_p of BYTES_RECORD_MAX. */
+    static constexpr unsigned short BYTES_RECORD_MAX = HEADER_SIZE + 1 + UCHAR_MAX + 1;
+
+    static ByteBuffer::iterator readBytes(ByteBuffer::iterator& it, unsigned char id, ConfigParameterType type,
+                                          char* buffer_p, const char*& bytes_p, unsigned char& length,
+                                          bool isVerified);
+    static ByteBuffer::iterator writeBytes(ByteBuffer::iterator& it, unsigned char id, ConfigParameterType type,
+                                           const char* bytes_p, unsigned char length);
+
+    /* Counter: id, type, PersistCounter record, CRC8 of the value */
+    static ByteBuffer::iterator readCounter(ByteBuffer::iterator& it, unsigned char id,
+                                            PersistCounter& counter, bool isVerified);
+    static ByteBuffer::iterator writeCounter(ByteBuffer::iterator& it, unsigned char id,
+                                             PersistCounter& counter);
+
+protected:
+    ByteBuffer::iterator readRecord(ByteBuffer::iterator& it, char* payload_p, unsigned char length) {
+        return readRecord(it, mId, mType, payload_p, length, mIsVerified);
+    }
+    ByteBuffer::iterator writeRecord(ByteBuffer::iterator& it, const char* payload_p, unsigned char length) {
+        return writeRecord(it, mId, mType, payload_p, length);
+    }
+
+    /* CRC8 of the payload matches checksum, or setVerified */
+    bool isChecksumValid(const char* payload_p, size_t length, char checksum) const {
+        return mIsVerified || (static_cast<char>(crc8(payload_p, length)) == checksum);
+    }
+
 protected:
     ConfigParameterType mType;
     unsigned char mId;
     bool mIsValid;
+
+    /* ConfigParameterElementOf<T>::tag() of the value type */
+    const void* mElement_p;
+
+    ByteBuffer* mSource_p;
+    unsigned short mSourceOffset;
+
+    bool mIsDirty;
+    bool mIsVerified;
+    unsigned short mRecordOffset;
+    unsigned short mRecordLength;
+};
+
+/* ConfigParameterType stored for a value type, INVALID if not supported.
+ * Arrays share one tag whatever the element type is. */
+template <typename T>
+struct ConfigParameterTypeOf {
+    static constexpr ConfigParameterType value = ConfigParameterType::INVALID;
+};
+
+template <>
+struct ConfigParameterTypeOf<char> {
+    static constexpr ConfigParameterType value = ConfigParameterType::BYTE;
+};
+
+template <>
+struct ConfigParameterTypeOf<int> {
+    static constexpr ConfigParameterType value = ConfigParameterType::NUMBER;
+};
+
+template <>
+struct ConfigParameterTypeOf<std::string> {
+    static constexpr ConfigParameterType value = ConfigParameterType::STRING;
+};
+
+template <>
+struct ConfigParameterTypeOf<IPAddress> {
+    static constexpr ConfigParameterType value = ConfigParameterType::IP_ADDRESS;
+};
+
+template <typename T>
+struct ConfigParameterTypeOf<std::vector<T>> {
+    static constexpr ConfigParameterType value = ConfigParameterType::ARRAY;
+};
+
+template <>
+struct ConfigParameterTypeOf<PersistCounter> {
+    static constexpr ConfigParameterType value = ConfigParameterType::COUNTER;
+};
+
+/* Distinct address per array element type, nullptr for other types */
+template <typename T>
+struct ConfigParameterElementOf {
+    static const void* tag() { return nullptr; }
 };
 
+template <typename T>
+struct ConfigParameterElementOf<std::vector<T>> {
+    static constexpr char TAG = 0;
+    static const void* tag() { return &TAG; }
+};
+
+template <typename T>
+bool ConfigParameterBase::holds() const {
+
+    return (mType == ConfigParameterTypeOf<T>::value) &&
+           (mElement_p == ConfigParameterElementOf<T>::tag());
+}
+
 template <typename T>
 class ConfigParameterValue {
 public:
+    ConfigParameterValue() : mValue() {}
+    ConfigParameterValue(const T& value) : mValue(value) {}
+
     T& get() { return mValue; }
     void set(const T &value) { mValue = value; }
 public:
@@ -72,8 +234,45 @@ public:
     ConfigParameter(unsigned char id = INVALID_ID);
     ConfigParameter(unsigned char id, const T& value);
 
+    T& get() { if (!mIsDirty) { access(); } return mValue; }
+    const T& view() { decode(); return mValue; }
+    void set(const T& value) { mSource_p = nullptr; mIsDirty = true; mValue = value; }
+
     ByteBuffer::iterator read(ByteBuffer::iterator& it) override;
     ByteBuffer::iterator write(ByteBuffer::iterator& it) override;
+
+    std::shared_ptr<ConfigParameterBase> clone() const override { return std::make_shared<ConfigParameter>(*this); }
+
+    unsigned short recordSize() override;
+};
+
+/* Array element stored little endian, whatever the byte order of the
+ * target: its bits go through the unsigned integer of the same size */
+template <typename T>
+struct ConfigParameterElement {
+    using Bits = typename std::conditional<sizeof(T) == 1, uint8_t,
+                 typename std::conditional<sizeof(T) == 2, uint16_t,
+                 typename std::conditional<sizeof(T) == 4, uint32_t, uint64_t>::type>::type>::type;
+
+    static_assert(sizeof(Bits) == sizeof(T), "Unsupported element size");
+
+    static void encode(const T& value, char* bytes_p) {
+        Bits bits;
+        memcpy(&bits, &value, sizeof(T));
+        for (unsigned char ix = 0; ix < sizeof(T); ++ix) {
+            bytes_p[ix] = NBYTE(ix, bits);
+        }
+    }
+
+    static T decode(const char* bytes_p) {
+        Bits bits = 0;
+        for (unsigned char ix = 0; ix < sizeof(T); ++ix) {
+            bits = BYTE_SET(ix, bits, bytes_p[ix]);
+        }
+        T value;
+        memcpy(&value, &bits, sizeof(T));
+        return value;
+    }
 };
 
 // Class ConfigParameter<vector<T>>
@@ -84,48 +283,67 @@ class ConfigParameter<std::vector<T>>
     public ConfigParameterValue<std::vector<T>>
 {
 public:
+    using ConfigParameterValue<std::vector<T>>::mValue;
+
     ConfigParameter(unsigned char id = INVALID_ID);
     ConfigParameter(unsigned char id, const std::vector<T>& value);
 
+    std::vector<T>& get() { if (!mIsDirty) { access(); } return mValue; }
+    const std::vector<T>& view() { decode(); return mValue; }
+    void set(const std::vector<T>& value) { mSource_p = nullptr; mIsDirty = true; mValue = value; }
+
     operator std::vector<T>();
     std::vector<T> &operator=(const std::vector<T> &value);
 
     ByteBuffer::iterator read(ByteBuffer::iterator& it) override;
     ByteBuffer::iterator write(ByteBuffer::iterator& it) override;
 
-private:
-    std::vector<T> mValue;
-    bool mIsValid;
+    std::shared_ptr<ConfigParameterBase> clone() const override { return std::make_shared<ConfigParameter>(*this); }
+
+    unsigned short recordSize() override;
 };
 
 template <typename T>
 ConfigParameter<std::vector<T>>::ConfigParameter(unsigned char id)
-    : ConfigParameterBase(ConfigParameterType::ARRAY, id, false), mValue({}) {
+    : ConfigParameterBase(ConfigParameterType::ARRAY, id, false),
+      ConfigParameterValue<std::vector<T>>{} {
 
     static_assert(std::is_arithmetic<T>::value, "Not an arithmetic type");
+
+    mElement_p = ConfigParameterElementOf<std::vector<T>>::tag();
 };
 
 template <typename T>
 ConfigParameter<std::vector<T>>::ConfigParameter(unsigned char id,
                                                  const std::vector<T> &value)
-    : ConfigParameterBase(ConfigParameterType::ARRAY, id, true), mValue(value) {
+    : ConfigParameterBase(ConfigParameterType::ARRAY, id, true),
+      ConfigParameterValue<std::vector<T>>{value} {
 
     static_assert(std::is_arithmetic<T>::value, "Not an arithmetic type");
+
+    mElement_p = ConfigParameterElementOf<std::vector<T>>::tag();
 };
 
 template <typename T>
 ConfigParameter<std::vector<T>>::operator std::vector<T>() {
 
-    return mValue;
+    return get();
 }
 
 template <typename T>
 std::vector<T> &ConfigParameter<std::vector<T>>::operator=(const std::vector<T>& value) {
 
-    this->mValue = value;
+    set(value);
     return this->mValue;
 }
 
+template <typename T>
+unsigned short ConfigParameter<std::vector<T>>::recordSize() {
+
+    /* id, type, count, elements, checksum */
+    return HEADER_SIZE + 1 + std::min<size_t>(mValue.size(), UCHAR_MAX) * sizeof(T) + 1;
+}
+
 template <typename T>
 ByteBuffer::iterator
 ConfigParameter<std::vector<T>>::read(ByteBuffer::iterator &it) {
@@ -134,29 +352,29 @@ ConfigParameter<std::vector<T>>::read(ByteBuffer::iterator &it) {
 
     if (nextIt != it) {
 
-        char length = *nextIt++;
+        unsigned char length = nextIt.mBuffer_p->read<unsigned char>(nextIt);
+        ++nextIt;
 
-        mValue.clear();
+        std::vector<char> payload(length * sizeof(T));
 
-        for (unsigned char ix = 0; ix < length; ++ix) {
+        nextIt.mBuffer_p->read(nextIt, payload.data(), payload.size());
+        nextIt += payload.size();
 
-            T currValue = 0;
+        char checksum = nextIt.mBuffer_p->read<char>(nextIt);
 
-            for (unsigned char ix = 0; ix < sizeof(T); ++ix) {
-                currValue |= BYTE_SET(ix, 0x00, *nextIt++);
-            }
+        if (!isChecksumValid(payload.data(), payload.size(), checksum)) {
 
-            mValue.push_back(currValue);
+            LOG("Invalid checksum (0x%X): id=%d, type=%d",
+                        checksum, mId, mType);
+            return it;
         }
 
-        char checksum = checksum::Checksum(checksum::Checksum::CRC8)
-                            .calculate<typename std::vector<T>::iterator>(mValue.begin(), mValue.end());
+        ++nextIt;
 
-        if (checksum != *nextIt++) {
+        mValue.resize(length);
 
-            LOG("Invalid checksum (0x%X): id=%d, type=%d",
-                        checksum, mId, mType);
-            return it;
+        for (unsigned char ex = 0; ex < length; ++ex) {
+            mValue[ex] = ConfigParameterElement<T>::decode(payload.data() + ex * sizeof(T));
         }
 
 #if LOG_LEVEL >= LOG_LEVEL_DEBUG
@@ -179,19 +397,24 @@ ConfigParameter<std::vector<T>>::write(ByteBuffer::iterator &it) {
 
     auto nextIt = ConfigParameterBase::write(it);
 
-    char checksum = checksum::Checksum(checksum::Checksum::CRC8)
-                        .calculate<typename std::vector<T>::iterator>(mValue.begin(), mValue.end());
+    unsigned char length = std::min<size_t>(mValue.size(), UCHAR_MAX);
 
-    *nextIt++ = mValue.size();
+    std::vector<char> payload(length * sizeof(T));
 
-    for (unsigned char ix = 0; ix < mValue.size(); ++ix) {
-        for (unsigned char jx = 0; jx < sizeof(T); ++jx) {
-
-            *nextIt++ = mValue[ix];
-        }
+    for (unsigned char ex = 0; ex < length; ++ex) {
+        ConfigParameterElement<T>::encode(mValue[ex], payload.data() + ex * sizeof(T));
     }
 
-    *nextIt++ = checksum;
+    char checksum = crc8(payload.data(), payload.size());
+
+    nextIt.mBuffer_p->write<unsigned char>(nextIt, length);
+    ++nextIt;
+
+    nextIt.mBuffer_p->write(nextIt, payload.data(), payload.size());
+    nextIt += payload.size();
+
+    nextIt.mBuffer_p->write<char>(nextIt, checksum);
+    ++nextIt;
 
 #if LOG_LEVEL >= LOG_LEVEL_DEBUG
     console::format("CFG => W [%02d]:", mId);
@@ -218,11 +441,23 @@ public:
     ConfigParameter(unsigned char id = INVALID_ID);
     ConfigParameter(unsigned char id, const PersistCounter& counter);
 
+    PersistCounter& get() { if (!mIsDirty) { access(); } return mValue; }
+    const PersistCounter& view() { decode(); return mValue; }
+    void set(const PersistCounter& value) { mSource_p = nullptr; mIsDirty = true; mValue = value; }
+
     operator PersistCounter();
     PersistCounter &operator=(const PersistCounter& value);
 
+    /* Flush policy of the counter, without marking it dirty */
+    PersistCounter::Type pending() const { return isDeferred() ? 0 : mValue.pending(); }
+    bool isFlushDue() const { return !isDeferred() && mValue.isFlushDue(); }
+
     ByteBuffer::iterator read(ByteBuffer::iterator &it);
     ByteBuffer::iterator write(ByteBuffer::iterator &it);
+
+    std::shared_ptr<ConfigParameterBase> clone() const override { return std::make_shared<ConfigParameter>(*this); }
+
+    unsigned short recordSize() override;
 };
 
 } // namespace
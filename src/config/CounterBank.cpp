@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <algorithm>
+#include <Arduino.h>
+#include <macros/byte.h>
+#include <console.h>
+
+#include "CounterBank.h"
+#include "Crc.h"
+#include "SlotRing.h"
+
+using namespace console;
+using namespace config;
+
+// Class CounterBank
+
+CounterBank::CounterBank(ByteBuffer& buffer, unsigned char count, unsigned short offset, unsigned short size)
+    : mBuffer(buffer),
+      mOffset(offset),
+      mSlots(0),
+      mSlot(0),
+      mSequence(0),
+      mValues(count, 0),
+      mScratch(1 + count * sizeof(Type) + 1),
+      mFlushIncrements(1),
+      mFlushInterval(0),
+      mPending(0),
+      mFlushedAt(millis()) {
+
+    unsigned short region = size ? size : buffer.size() - offset;
+
+    if (count && (region > HEADER_SIZE)) {
+        mSlots = std::min<unsigned short>(255, (region - HEADER_SIZE) / slotSize());
+    }
+}
+
+unsigned short CounterBank::slotSize() const {
+
+    return mScratch.size();
+}
+
+unsigned short CounterBank::slotBegin(unsigned char slot) const {
+
+    return mOffset + HEADER_SIZE + slot * slotSize();
+}
+
+bool CounterBank::readSlot(unsigned char slot, unsigned char& sequence) {
+
+    char* slot_p = mScratch.data();
+    unsigned short size = slotSize();
+
+    if (mBuffer.read(mBuffer.begin() + slotBegin(slot), slot_p, size) != size) {
+        return false;
+    }
+
+    if (static_cast<char>(crc8(slot_p, size - 1)) != slot_p[size - 1]) {
+        return false;
+    }
+
+    sequence = slot_p[0];
+
+    return true;
+}
+
+void CounterBank::writeSlot(unsigned char slot, unsigned char sequence) {
+
+    char* slot_p = mScratch.data();
+    unsigned short size = slotSize();
+
+    slot_p[0] = static_cast<char>(sequence);
+
+    for (unsigned char cx = 0; cx < mValues.size(); ++cx) {
+        for (unsigned char ix = 0; ix < sizeof(Type); ++ix) {
+            slot_p[1 + cx * sizeof(Type) + ix] = NBYTE(ix, mValues[cx]);
+        }
+    }
+
+    slot_p[size - 1] = crc8(slot_p, size - 1);
+
+    mBuffer.write(mBuffer.begin() + slotBegin(slot), slot_p, size);
+}
+
+void CounterBank::format() {
+
+    LOG("Format counter bank: %u counters, %u slots", count(), mSlots);
+
+    char erased[64];
+    std::fill(std::begin(erased), std::end(erased), ERASED);
+
+    unsigned short end = slotBegin(mSlots);
+
+    for (unsigned short offset = slotBegin(0); offset < end; offset += sizeof(erased)) {
+        mBuffer.write(mBuffer.begin() + offset, erased, std::min<unsigned short>(sizeof(erased), end - offset));
+    }
+
+    char header[HEADER_SIZE] = {
+        static_cast<char>(MAGIC_0),
+        static_cast<char>(MAGIC_1),
+        static_cast<char>(count()),
+        static_cast<char>(mSlots),
+    };
+
+    header[HEADER_SIZE - 1] = crc8(header, HEADER_SIZE - 1);
+
+    mBuffer.write(mBuffer.begin() + mOffset, header, HEADER_SIZE);
+    mBuffer.commit();
+
+    /* The first flush fills slot 0 */
+    mSlot = mSlots - 1;
+    mSequence = 0xFF;
+}
+
+bool CounterBank::mount() {
+
+    if (mSlots < 2) {
+        LOG("Counter bank region too small: %u slots", mSlots);
+        return false;
+    }
+
+    std::fill(mValues.begin(), mValues.end(), 0);
+
+    mPending = 0;
+    mFlushedAt = millis();
+
+    char header[HEADER_SIZE];
+    mBuffer.read(mBuffer.begin() + mOffset, header, HEADER_SIZE);
+
+    bool isValid = (static_cast<unsigned char>(header[0]) == MAGIC_0) &&
+                   (static_cast<unsigned char>(header[1]) == MAGIC_1) &&
+                   (static_cast<unsigned char>(header[2]) == count()) &&
+                   (static_cast<unsigned char>(header[3]) == mSlots) &&
+                   (static_cast<char>(crc8(header, HEADER_SIZE - 1)) ==
+                    header[HEADER_SIZE - 1]);
+
+    unsigned char slot;
+    unsigned char sequence;
+
+    auto readSequence = [this](unsigned char ix, unsigned char& ixSequence) {
+        return readSlot(ix, ixSequence);
+    };
+
+    /* No valid slot may leave stale ones which continue a new sequence */
+    if (!isValid || !findCurrentSlot(mSlots, readSequence, slot) || !readSlot(slot, sequence)) {
+        format();
+        return true;
+    }
+
+    for (unsigned char cx = 0; cx < mValues.size(); ++cx) {
+        for (unsigned char ix = 0; ix < sizeof(Type); ++ix) {
+            mValues[cx] |= BYTE_SET(ix, 0x00ULL, mScratch[1 + cx * sizeof(Type) + ix]);
+        }
+    }
+
+    mSlot = slot;
+    mSequence = sequence;
+
+    LOG("Counter bank slot %u, sequence %u", mSlot, mSequence);
+
+    return true;
+}
+
+unsigned char CounterBank::count() const {
+
+    return mValues.size();
+}
+
+unsigned char CounterBank::slots() const {
+
+    return mSlots;
+}
+
+CounterBank::Type CounterBank::get(unsigned char ix) const {
+
+    return (ix < mValues.size()) ? mValues[ix] : 0;
+}
+
+void CounterBank::set(unsigned char ix, Type value) {
+
+    if (ix < mValues.size()) {
+        mValues[ix] = value;
+        mPending = ASSIGNED;
+    }
+}
+
+void CounterBank::add(unsigned char ix, Type delta) {
+
+    if (ix < mValues.size()) {
+        mValues[ix] += delta;
+        mPending = (delta < ASSIGNED - mPending) ? mPending + delta : ASSIGNED;
+    }
+}
+
+void CounterBank::setFlushPolicy(unsigned long increments, unsigned long interval) {
+
+    mFlushIncrements = increments;
+    mFlushInterval = interval;
+}
+
+unsigned long CounterBank::pending() const {
+
+    return mPending;
+}
+
+bool CounterBank::isFlushDue() const {
+
+    if (!mPending) {
+        return false;
+    }
+
+    if ((mPending == ASSIGNED) || (mFlushIncrements && (mPending >= mFlushIncrements))) {
+        return true;
+    }
+
+    return mFlushInterval && (millis() - mFlushedAt >= mFlushInterval);
+}
+
+bool CounterBank::flush(bool force) {
+
+    if ((mSlots < 2) || !mPending || (!force && !isFlushDue())) {
+        return false;
+    }
+
+    unsigned char slot = (mSlot + 1) % mSlots;
+
+    writeSlot(slot, mSequence + 1);
+    mBuffer.commit();
+
+    mSlot = slot;
+    mSequence += 1;
+
+    mPending = 0;
+    mFlushedAt = millis();
+
+    return true;
+}
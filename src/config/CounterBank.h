@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "ByteBuffer.h"
+
+namespace config {
+
+/* 64-bit counters sharing one wear levelled region of a ByteBuffer.
+ *
+ *   header:  magic (2), count, slots, CRC8
+ *   slot:    sequence, count values (8 bytes, little endian), CRC8
+ *
+ * A flush writes all counters as one slot, the one after the current
+ * slot (see SlotRing.h), and commits. A slot torn by a reset fails its
+ * CRC, the previous one stays current. The flush policy is the one of
+ * PersistCounter: at most increments - 1 counts or those of the last
+ * interval ms (plus the time between two checks) are lost. */
+class CounterBank {
+public:
+    using Type = unsigned long long;
+
+    /* size 0: up to the end of buffer */
+    CounterBank(ByteBuffer& buffer, unsigned char count, unsigned short offset = 0, unsigned short size = 0);
+    ~CounterBank() = default;
+
+    CounterBank(CounterBank const&) = delete;
+    CounterBank& operator= (CounterBank const&) = delete;
+
+    /* Reads the current slot, formats the region if its header does not
+     * match. false if the region cannot hold two slots. */
+    bool mount();
+
+    unsigned char count() const;
+    unsigned char slots() const;
+
+    Type get(unsigned char ix) const;
+    void set(unsigned char ix, Type value);
+    void add(unsigned char ix, Type delta = 1);
+
+    /* See PersistCounter::setFlushPolicy */
+    void setFlushPolicy(unsigned long increments, unsigned long interval = 0);
+
+    /* Counts added since the last flush or mount, an assignment makes the
+     * flush due at once */
+    unsigned long pending() const;
+    bool isFlushDue() const;
+
+    /* Writes a slot if the policy is due or, with force, anything is
+     * pending. true if it wrote. */
+    bool flush(bool force = false);
+
+private:
+    static constexpr unsigned char MAGIC_0 = 0x43;  /* 'C' */
+    static constexpr unsigned char MAGIC_1 = 0x42;  /* 'B' */
+    static constexpr unsigned short HEADER_SIZE = 5;
+    static constexpr unsigned long ASSIGNED = static_cast<unsigned long>(-1);
+    static constexpr char ERASED = static_cast<char>(0xFF);
+
+    unsigned short slotSize() const;
+    unsigned short slotBegin(unsigned char slot) const;
+
+    /* Slot into the scratch, false if it is erased or invalid */
+    bool readSlot(unsigned char slot, unsigned char& sequence);
+    void writeSlot(unsigned char slot, unsigned char sequence);
+
+    void format();
+
+private:
+    ByteBuffer& mBuffer;
+    unsigned short mOffset;
+    unsigned char mSlots;
+
+    unsigned char mSlot;
+    unsigned char mSequence;
+
+    std::vector<Type> mValues;
+    std::vector<char> mScratch;
+
+    unsigned long mFlushIncrements;
+    unsigned long mFlushInterval;
+    unsigned long mPending;
+    unsigned long mFlushedAt;
+};
+
+} // namespace
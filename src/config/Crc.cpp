@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <bit>
+#include <string.h>
+
+#include "Crc.h"
+
+#if !CONFIG_PLATFORM_HOST
+#include <Arduino.h>
+#endif
+
+using namespace config;
+
+/* Pins the table to the CRC-8/SMBUS check value */
+static_assert([] {
+
+    const char check[] = "123456789";
+    unsigned char crc = 0;
+
+    for (size_t ix = 0; ix < sizeof(check) - 1; ++ix) {
+        crc = CRC8_TABLE[crc ^ static_cast<unsigned char>(check[ix])];
+    }
+
+    return crc;
+}() == 0xF4, "CRC-8 check value");
+
+namespace {
+
+constexpr uint32_t CRC32_POLYNOMIAL = 0xEDB88320;  /* reflected 0x04C11DB7 */
+
+#if CONFIG_PLATFORM_HOST
+
+/* Table k: CRC of a byte followed by k zero bytes */
+constexpr std::array<std::array<uint32_t, 256>, 8> CRC32_TABLES = [] {
+
+    std::array<std::array<uint32_t, 256>, 8> tables {};
+
+    for (unsigned short ix = 0; ix < 256; ++ix) {
+
+        uint32_t crc = ix;
+
+        for (unsigned char bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1) ? ((crc >> 1) ^ CRC32_POLYNOMIAL) : (crc >> 1);
+        }
+
+        tables[0][ix] = crc;
+    }
+
+    for (unsigned short ix = 0; ix < 256; ++ix) {
+        for (unsigned char kx = 1; kx < 8; ++kx) {
+            tables[kx][ix] = (tables[kx - 1][ix] >> 8) ^ tables[0][tables[kx - 1][ix] & 0xFF];
+        }
+    }
+
+    return tables;
+}();
+
+#else
+
+/* The tables of the device are read from flash with pgm_read_*() */
+const std::array<unsigned char, 256> CRC8_FLASH PROGMEM = CRC8_TABLE;
+
+constexpr std::array<uint32_t, 16> CRC32_NIBBLES PROGMEM = [] {
+
+    std::array<uint32_t, 16> table {};
+
+    for (unsigned char ix = 0; ix < table.size(); ++ix) {
+
+        uint32_t crc = ix;
+
+        for (unsigned char bit = 0; bit < 4; ++bit) {
+            crc = (crc & 1) ? ((crc >> 1) ^ CRC32_POLYNOMIAL) : (crc >> 1);
+        }
+
+        table[ix] = crc;
+    }
+
+    return table;
+}();
+
+#endif
+
+} // namespace
+
+uint32_t config::crc32(const char* data_p, size_t length, uint32_t crc) {
+
+    auto bytes_p = reinterpret_cast<const unsigned char*>(data_p);
+
+    crc = ~crc;
+
+#if CONFIG_PLATFORM_HOST
+    if constexpr (std::endian::native == std::endian::little) {
+
+        const auto& t = CRC32_TABLES;
+
+        for (; length >= 8; length -= 8, bytes_p += 8) {
+
+            uint32_t low;
+            uint32_t high;
+
+            memcpy(&low, bytes_p, sizeof(low));
+            memcpy(&high, bytes_p + 4, sizeof(high));
+
+            low ^= crc;
+
+            crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^
+                  t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+                  t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF] ^
+                  t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+        }
+    }
+
+    for (; length > 0; --length, ++bytes_p) {
+        crc = (crc >> 8) ^ CRC32_TABLES[0][(crc ^ *bytes_p) & 0xFF];
+    }
+#else
+    for (; length > 0; --length, ++bytes_p) {
+        crc ^= *bytes_p;
+        crc = (crc >> 4) ^ pgm_read_dword(&CRC32_NIBBLES[crc & 0x0F]);
+        crc = (crc >> 4) ^ pgm_read_dword(&CRC32_NIBBLES[crc & 0x0F]);
+    }
+#endif
+
+    return ~crc;
+}
+
+#if !CONFIG_PLATFORM_HOST
+
+unsigned char config::crc8(const char* data_p, size_t length, unsigned char crc) {
+
+    for (size_t ix = 0; ix < length; ++ix) {
+        crc = pgm_read_byte(&CRC8_FLASH[crc ^ static_cast<unsigned char>(data_p[ix])]);
+    }
+
+    return crc;
+}
+
+#endif
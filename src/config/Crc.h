@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#pragma once
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace config {
+
+/* CRC-8/SMBUS: polynomial 0x07, init 0, no reflection, check value 0xF4
+ * for "123456789". checksum::Checksum(CRC8) of the record formats, one
+ * table lookup per byte. */
+inline constexpr std::array<unsigned char, 256> CRC8_TABLE = [] {
+
+    std::array<unsigned char, 256> table {};
+
+    for (unsigned short ix = 0; ix < table.size(); ++ix) {
+
+        unsigned char crc = ix;
+
+        for (unsigned char bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) : (crc << 1);
+        }
+
+        table[ix] = crc;
+    }
+
+    return table;
+}();
+
+#if CONFIG_PLATFORM_HOST
+
+/* crc continues a previous call */
+inline unsigned char crc8(const char* data_p, size_t length, unsigned char crc = 0) {
+
+    for (size_t ix = 0; ix < length; ++ix) {
+        crc = CRC8_TABLE[crc ^ static_cast<unsigned char>(data_p[ix])];
+    }
+
+    return crc;
+}
+
+#else
+
+/* Through a copy of the table in flash. crc continues a previous call. */
+unsigned char crc8(const char* data_p, size_t length, unsigned char crc = 0);
+
+#endif
+
+/* CRC-32 (IEEE 802.3), check value 0xCBF43926, slicing-by-8 on the host,
+ * a 16 entry table in flash on the device. crc continues a previous call. */
+uint32_t crc32(const char* data_p, size_t length, uint32_t crc = 0);
+
+} // namespace
@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <algorithm>
+#include <string.h>
+#include <macros/byte.h>
+#include <console.h>
+
+#include "DualSlotByteBuffer.h"
+#include "Crc.h"
+
+using namespace console;
+using namespace config;
+
+DualSlotByteBuffer::DualSlotByteBuffer(ByteBuffer& backend, unsigned short offset, unsigned short size)
+  : mBackend(backend),
+    mOffset(offset),
+    mSize(0),
+    mActive(NO_SLOT),
+    mGeneration(0),
+    mIsOpen(false)
+{
+    unsigned short region = size ? size : backend.size() - offset;
+
+    if (region / 2 > HEADER_SIZE) {
+        mSize = region / 2 - HEADER_SIZE;
+    }
+}
+
+unsigned short DualSlotByteBuffer::size()
+{
+    return mSize;
+}
+
+unsigned short DualSlotByteBuffer::imageBegin(unsigned char slot) const
+{
+    return mOffset + slot * (HEADER_SIZE + mSize) + HEADER_SIZE;
+}
+
+unsigned char DualSlotByteBuffer::nextSlot() const
+{
+    return (mActive == NO_SLOT) ? 0 : mActive ^ 1;
+}
+
+unsigned char DualSlotByteBuffer::readSlot() const
+{
+    return mIsOpen ? nextSlot() : mActive;
+}
+
+const char DualSlotByteBuffer::read(unsigned short index)
+{
+    unsigned char slot = readSlot();
+
+    return (slot == NO_SLOT) ? ERASED : mBackend.read(imageBegin(slot) + index);
+}
+
+void DualSlotByteBuffer::write(unsigned short index, const char value)
+{
+    open();
+
+    mBackend.write(imageBegin(nextSlot()) + index, value);
+}
+
+unsigned short DualSlotByteBuffer::readBlock(unsigned short index, char* data_p, unsigned short length)
+{
+    unsigned char slot = readSlot();
+
+    if (slot == NO_SLOT) {
+        memset(data_p, ERASED, length);
+        return length;
+    }
+
+    return mBackend.readBlock(imageBegin(slot) + index, data_p, length);
+}
+
+unsigned short DualSlotByteBuffer::writeBlock(unsigned short index, const char* data_p, unsigned short length)
+{
+    open();
+
+    return mBackend.writeBlock(imageBegin(nextSlot()) + index, data_p, length);
+}
+
+void DualSlotByteBuffer::open()
+{
+    if (mIsOpen) {
+        return;
+    }
+
+    unsigned char target = nextSlot();
+    char chunk[64];
+
+    /* The stale image stops being a fallback before it is changed */
+    mBackend.write(imageBegin(target) - HEADER_SIZE, ERASED);
+
+    for (unsigned short offset = 0; offset < mSize; offset += sizeof(chunk)) {
+
+        unsigned short length = std::min<unsigned short>(sizeof(chunk), mSize - offset);
+
+        if (mActive == NO_SLOT) {
+            memset(chunk, ERASED, length);
+        } else {
+            mBackend.readBlock(imageBegin(mActive) + offset, chunk, length);
+        }
+
+        mBackend.writeBlock(imageBegin(target) + offset, chunk, length);
+    }
+
+    mIsOpen = true;
+}
+
+void DualSlotByteBuffer::commit()
+{
+    if (!mIsOpen) {
+        return;
+    }
+
+    unsigned char target = nextSlot();
+
+    /* Image first, the header makes it valid */
+    mBackend.commit();
+
+    writeHeader(target, mGeneration + 1, imageCrc(target));
+    mBackend.commit();
+
+    mActive = target;
+    mGeneration += 1;
+    mIsOpen = false;
+
+    LOG("Image slot %u, generation %lu", mActive, mGeneration);
+}
+
+void DualSlotByteBuffer::rollback()
+{
+    mIsOpen = false;
+}
+
+bool DualSlotByteBuffer::mount(bool verify)
+{
+    mActive = NO_SLOT;
+    mGeneration = 0;
+    mIsOpen = false;
+
+    if (!mSize) {
+        LOG("Image slots too small");
+        return false;
+    }
+
+    unsigned long generations[2] = { 0, 0 };
+    uint32_t crcs[2];
+
+    for (unsigned char slot = 0; slot < 2; ++slot) {
+
+        if (!readHeader(slot, generations[slot], crcs[slot]) ||
+            (verify && (imageCrc(slot) != crcs[slot]))) {
+            generations[slot] = 0;
+        }
+    }
+
+    if (!generations[0] && !generations[1]) {
+        return false;
+    }
+
+    mActive = (generations[1] > generations[0]) ? 1 : 0;
+    mGeneration = generations[mActive];
+
+    return true;
+}
+
+unsigned char DualSlotByteBuffer::slot() const
+{
+    return mActive;
+}
+
+unsigned long DualSlotByteBuffer::generation() const
+{
+    return mGeneration;
+}
+
+bool DualSlotByteBuffer::readHeader(unsigned char slot, unsigned long& generation, uint32_t& crc)
+{
+    char header[HEADER_SIZE];
+
+    mBackend.readBlock(imageBegin(slot) - HEADER_SIZE, header, HEADER_SIZE);
+
+    if ((static_cast<unsigned char>(header[0]) != MAGIC_0) ||
+        (static_cast<unsigned char>(header[1]) != MAGIC_1) ||
+        (static_cast<char>(crc8(header, HEADER_SIZE - 1)) != header[HEADER_SIZE - 1])) {
+        return false;
+    }
+
+    generation = 0;
+    crc = 0;
+
+    for (unsigned char ix = 0; ix < 4; ++ix) {
+        generation |= BYTE_SET(ix, 0x00, header[2 + ix]);
+        crc |= BYTE_SET(ix, 0x00, header[6 + ix]);
+    }
+
+    return generation != 0;
+}
+
+void DualSlotByteBuffer::writeHeader(unsigned char slot, unsigned long generation, uint32_t crc)
+{
+    char header[HEADER_SIZE] = { static_cast<char>(MAGIC_0), static_cast<char>(MAGIC_1) };
+
+    for (unsigned char ix = 0; ix < 4; ++ix) {
+        header[2 + ix] = NBYTE(ix, generation);
+        header[6 + ix] = NBYTE(ix, crc);
+    }
+
+    header[HEADER_SIZE - 1] = crc8(header, HEADER_SIZE - 1);
+
+    mBackend.writeBlock(imageBegin(slot) - HEADER_SIZE, header, HEADER_SIZE);
+}
+
+uint32_t DualSlotByteBuffer::imageCrc(unsigned char slot)
+{
+    const char* data_p = mBackend.data();
+
+    if (data_p) {
+        return crc32(data_p + imageBegin(slot), mSize);
+    }
+
+    char chunk[64];
+    uint32_t crc = 0;
+
+    for (unsigned short offset = 0; offset < mSize; offset += sizeof(chunk)) {
+
+        unsigned short length = std::min<unsigned short>(sizeof(chunk), mSize - offset);
+
+        mBackend.readBlock(imageBegin(slot) + offset, chunk, length);
+        crc = crc32(chunk, length, crc);
+    }
+
+    return crc;
+}
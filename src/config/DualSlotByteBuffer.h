@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "ByteBuffer.h"
+
+namespace config {
+
+/* A/B image slots in a region of another ByteBuffer.
+ *
+ *   slot:    magic (2), generation (4), CRC32 of the image (4), CRC8, image
+ *
+ * Reads come from the active slot. The first write after a commit copies
+ * the active image into the other slot and invalidates its header, the
+ * writes then go there. commit() commits the image, writes the header
+ * with the next generation and the image CRC32 last and commits again:
+ * until then the active slot is untouched. mount() picks the slot with
+ * the newest valid header by reading the two headers.
+ *
+ * A reset at any point leaves one complete image only if the backend
+ * erases and programs the two slots separately, i.e. they sit in
+ * different flash sectors and a commit rewrites only the changed one.
+ * StorageEeprom does not qualify: the ESP8266 EEPROM emulation erases
+ * and reprograms its whole sector on every commit, a power loss during
+ * that erase loses both slots. */
+class DualSlotByteBuffer : public ByteBuffer {
+public:
+    /* size 0: up to the end of backend */
+    DualSlotByteBuffer(ByteBuffer& backend, unsigned short offset = 0, unsigned short size = 0);
+    ~DualSlotByteBuffer() = default;
+
+    using ByteBuffer::read;
+    using ByteBuffer::write;
+
+    const char read(unsigned short index);
+    void write(unsigned short index, const char value);
+
+    unsigned short readBlock(unsigned short index, char* data_p, unsigned short length);
+    unsigned short writeBlock(unsigned short index, const char* data_p, unsigned short length);
+
+    void commit();
+    unsigned short size();
+
+    /* Selects the slot with the newest valid header. verify checks the
+     * image CRC32 as well and falls back to the other slot. false if no
+     * slot is valid: the image reads as erased until the first commit. */
+    bool mount(bool verify = false);
+
+    /* Drops the writes since the last commit */
+    void rollback();
+
+    unsigned char slot() const;
+    unsigned long generation() const;
+
+private:
+    static constexpr unsigned char MAGIC_0 = 0x41;  /* 'A' */
+    static constexpr unsigned char MAGIC_1 = 0x42;  /* 'B' */
+    static constexpr unsigned short HEADER_SIZE = 11;
+    static constexpr unsigned char NO_SLOT = static_cast<unsigned char>(-1);
+    static constexpr char ERASED = static_cast<char>(0xFF);
+
+    unsigned short imageBegin(unsigned char slot) const;
+
+    /* Generation and image CRC32 of a valid header, false otherwise */
+    bool readHeader(unsigned char slot, unsigned long& generation, uint32_t& crc);
+    void writeHeader(unsigned char slot, unsigned long generation, uint32_t crc);
+
+    uint32_t imageCrc(unsigned char slot);
+
+    /* Starts the writes into the other slot */
+    void open();
+
+    /* Slot the writes go to */
+    unsigned char nextSlot() const;
+
+    /* Slot the reads come from, NO_SLOT if there is none */
+    unsigned char readSlot() const;
+
+private:
+    ByteBuffer& mBackend;
+    unsigned short mOffset;
+    unsigned short mSize;   /* image size of a slot */
+
+    unsigned char mActive;
+    unsigned long mGeneration;
+    bool mIsOpen;
+};
+
+} // namespace
@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <algorithm>
+#include <console.h>
+
+#include "ImageToc.h"
+#include "Crc.h"
+
+using namespace console;
+using namespace config;
+
+// Class ImageToc
+
+ImageToc::ImageToc(ByteBuffer& buffer)
+    : mBuffer(buffer), mData_p(nullptr), mCount(0), mEnd(0), mHasCrc(false), mIsValid(false) {
+
+    char header[HEADER_SIZE];
+    ByteBuffer::iterator it = buffer.begin();
+
+    if (buffer.read(it, header, HEADER_SIZE) != HEADER_SIZE) {
+        return;
+    }
+
+    if ((static_cast<unsigned char>(header[0]) != MAGIC_0) ||
+        ((static_cast<unsigned char>(header[1]) != MAGIC_1) &&
+         (static_cast<unsigned char>(header[1]) != MAGIC_1_CRC))) {
+        return;
+    }
+
+    mCount = header[2];
+    mEnd = BYTE_SET(0, 0x00, header[3]) | BYTE_SET(1, 0x00, header[4]);
+    mHasCrc = static_cast<unsigned char>(header[1]) == MAGIC_1_CRC;
+
+    if ((mEnd < size(mCount)) || (mEnd + (mHasCrc ? CRC_SIZE : 0) > buffer.size())) {
+        LOG("Invalid image table: count=%u, end=%u", mCount, mEnd);
+        return;
+    }
+
+    mData_p = it.data();
+    mIsValid = true;
+}
+
+bool ImageToc::isValid() const {
+
+    return mIsValid;
+}
+
+unsigned char ImageToc::count() const {
+
+    return mCount;
+}
+
+unsigned short ImageToc::end() const {
+
+    return mEnd;
+}
+
+bool ImageToc::hasCrc() const {
+
+    return mIsValid && mHasCrc;
+}
+
+bool ImageToc::isIntact() const {
+
+    if (!hasCrc()) {
+        return false;
+    }
+
+    char bytes[CRC_SIZE];
+    mBuffer.read(mBuffer.begin() + mEnd, bytes, CRC_SIZE);
+
+    uint32_t stored = 0;
+
+    for (unsigned char ix = 0; ix < CRC_SIZE; ++ix) {
+        stored |= BYTE_SET(ix, 0x00, bytes[ix]);
+    }
+
+    return stored == crc(mBuffer, mEnd);
+}
+
+uint32_t ImageToc::crc(ByteBuffer& buffer, unsigned short end) {
+
+    const char* data_p = buffer.data();
+
+    if (data_p) {
+        return crc32(data_p, end);
+    }
+
+    char chunk[64];
+    uint32_t value = 0;
+
+    for (unsigned short offset = 0; offset < end; offset += sizeof(chunk)) {
+
+        unsigned short length = std::min<unsigned short>(sizeof(chunk), end - offset);
+
+        buffer.read(buffer.begin() + offset, chunk, length);
+        value = crc32(chunk, length, value);
+    }
+
+    return value;
+}
+
+unsigned short ImageToc::readShort(unsigned short offset) const {
+
+    char bytes[2] = { 0, 0 };
+
+    mBuffer.read(mBuffer.begin() + offset, bytes, sizeof(bytes));
+
+    return BYTE_SET(0, 0x00, bytes[0]) | BYTE_SET(1, 0x00, bytes[1]);
+}
+
+bool ImageToc::entry(unsigned char ix, Entry& entry) const {
+
+    if (!mIsValid || (ix >= mCount)) {
+        return false;
+    }
+
+    /* The entry and the next one, for its offset */
+    char bytes[2 * ENTRY_SIZE];
+    unsigned short position = HEADER_SIZE + ix * ENTRY_SIZE;
+
+    mBuffer.read(mBuffer.begin() + position, bytes, (ix + 1 < mCount) ? sizeof(bytes) : ENTRY_SIZE);
+
+    unsigned short offset = BYTE_SET(0, 0x00, bytes[1]) | BYTE_SET(1, 0x00, bytes[2]);
+    unsigned short next = (ix + 1 < mCount)
+        ? (BYTE_SET(0, 0x00, bytes[ENTRY_SIZE + 1]) | BYTE_SET(1, 0x00, bytes[ENTRY_SIZE + 2]))
+        : mEnd;
+
+    if ((offset < size(mCount)) || (next < offset) || (next > mEnd)) {
+        LOG("Invalid image table entry %u: offset=%u, next=%u", ix, offset, next);
+        return false;
+    }
+
+    entry.id = bytes[0];
+    entry.offset = offset;
+    entry.length = next - offset;
+
+    return true;
+}
+
+const char* ImageToc::entryBytes(unsigned char first, char* bytes_p, unsigned char& count) const {
+
+    if (!mIsValid || (first >= mCount)) {
+        count = 0;
+        return nullptr;
+    }
+
+    /* In place when the buffer is contiguous */
+    if (mData_p) {
+        count = mCount - first;
+        return mData_p + HEADER_SIZE + first * ENTRY_SIZE;
+    }
+
+    count = std::min<unsigned char>(ENTRIES_BLOCK, mCount - first);
+    mBuffer.read(mBuffer.begin() + (HEADER_SIZE + first * ENTRY_SIZE), bytes_p, count * ENTRY_SIZE);
+
+    return bytes_p;
+}
+
+bool ImageToc::find(unsigned char id, Entry& entry) const {
+
+    unsigned char low = 0;
+    unsigned char high = mIsValid ? mCount : 0;
+
+    while (low < high) {
+
+        unsigned char middle = low + (high - low) / 2;
+        unsigned char middleId = mBuffer.read(HEADER_SIZE + middle * ENTRY_SIZE);
+
+        if (middleId == id) {
+            return this->entry(middle, entry);
+        }
+
+        if (middleId < id) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return false;
+}
+
+void ImageToc::writeEntry(ByteBuffer& buffer, unsigned char ix, unsigned char id, unsigned short offset) {
+
+    const char bytes[ENTRY_SIZE] = {
+        static_cast<char>(id),
+        static_cast<char>(NBYTE(0, offset)),
+        static_cast<char>(NBYTE(1, offset)),
+    };
+
+    buffer.write(buffer.begin() + (HEADER_SIZE + ix * ENTRY_SIZE), bytes, ENTRY_SIZE);
+}
+
+void ImageToc::writeHeader(ByteBuffer& buffer, unsigned char count, unsigned short end, bool hasCrc) {
+
+    const char header[HEADER_SIZE] = {
+        static_cast<char>(MAGIC_0),
+        static_cast<char>(hasCrc ? MAGIC_1_CRC : MAGIC_1),
+        static_cast<char>(count),
+        static_cast<char>(NBYTE(0, end)),
+        static_cast<char>(NBYTE(1, end)),
+    };
+
+    buffer.write(buffer.begin(), header, HEADER_SIZE);
+}
+
+void ImageToc::writeCrc(ByteBuffer& buffer, unsigned short end) {
+
+    uint32_t value = crc(buffer, end);
+
+    const char bytes[CRC_SIZE] = {
+        static_cast<char>(NBYTE(0, value)),
+        static_cast<char>(NBYTE(1, value)),
+        static_cast<char>(NBYTE(2, value)),
+        static_cast<char>(NBYTE(3, value)),
+    };
+
+    buffer.write(buffer.begin() + end, bytes, CRC_SIZE);
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "ByteBuffer.h"
+
+namespace config {
+
+/* Table of contents at the begin of a parameter image.
+ *
+ *   magic (2), count, end offset (2), count x [id, offset (2)], records
+ *
+ * Entries are sorted by id and the records follow in the same order, the
+ * length of a record is the distance to the next offset (or to the end
+ * offset for the last one). Offsets are little endian from the image
+ * begin. Images without the magic are legacy ones: records only, parsed
+ * in sequence. The first legacy record is parameter 0, so its first byte
+ * is never the magic.
+ *
+ * Entries are not checksummed, each record still carries its own. With
+ * the second magic byte MAGIC_1_CRC a CRC32 (little endian) of the bytes
+ * [0, end offset) follows the image: while it matches, the records need
+ * no check of their own. */
+class ImageToc {
+public:
+    static constexpr unsigned char MAGIC_0 = 0xC5;
+    static constexpr unsigned char MAGIC_1 = 0x7C;
+    static constexpr unsigned char MAGIC_1_CRC = 0x7D;
+    static constexpr unsigned short HEADER_SIZE = 5;
+    static constexpr unsigned short ENTRY_SIZE = 3;
+    static constexpr unsigned short CRC_SIZE = 4;
+
+    struct Entry {
+        unsigned char id;
+        unsigned short offset;
+        unsigned short length;
+    };
+
+    /* Table size, the offset of the first record */
+    static constexpr unsigned short size(unsigned char count) {
+        return HEADER_SIZE + count * ENTRY_SIZE;
+    }
+
+    /* Parses the header at the buffer begin */
+    explicit ImageToc(ByteBuffer& buffer);
+
+    /* false for legacy images or an invalid header */
+    bool isValid() const;
+
+    unsigned char count() const;
+    unsigned short end() const;
+
+    /* Image CRC32 present, and matching the image */
+    bool hasCrc() const;
+    bool isIntact() const;
+
+    /* Entry at position ix, false if it is out of the image */
+    bool entry(unsigned char ix, Entry& entry) const;
+
+    /* Raw entries from first on, count of them: up to the last one in
+     * place for a contiguous buffer, else up to ENTRIES_BLOCK read into
+     * bytes_p of ENTRIES_BLOCK * ENTRY_SIZE. nullptr past the table. */
+    static constexpr unsigned char ENTRIES_BLOCK = 16;
+
+    const char* entryBytes(unsigned char first, char* bytes_p, unsigned char& count) const;
+
+    /* The raw entry lists the record id at offset */
+    static bool isEntry(const char* entry_p, unsigned char id, unsigned short offset) {
+        return (static_cast<unsigned char>(entry_p[0]) == id) &&
+               (static_cast<unsigned char>(entry_p[1]) == (offset & 0xFF)) &&
+               (static_cast<unsigned char>(entry_p[2]) == (offset >> 8));
+    }
+
+    /* Binary search over the entries */
+    bool find(unsigned char id, Entry& entry) const;
+
+    /* Entry ix of a table of count entries, written by the image writer
+     * after each record */
+    static void writeEntry(ByteBuffer& buffer, unsigned char ix, unsigned char id, unsigned short offset);
+
+    /* Written last, the table is valid once the header is in place */
+    static void writeHeader(ByteBuffer& buffer, unsigned char count, unsigned short end, bool hasCrc = false);
+
+    /* Image CRC32 at end, after the header and every change of a record */
+    static void writeCrc(ByteBuffer& buffer, unsigned short end);
+
+private:
+    unsigned short readShort(unsigned short offset) const;
+
+    /* CRC32 of the bytes [0, end) */
+    static uint32_t crc(ByteBuffer& buffer, unsigned short end);
+
+private:
+    ByteBuffer& mBuffer;
+    const char* mData_p;    /* data() of a contiguous buffer */
+    unsigned char mCount;
+    unsigned short mEnd;
+    bool mHasCrc;
+    bool mIsValid;
+};
+
+} // namespace
@@ -7,115 +7,378 @@
  * (at your option) any later version.
  */
 
+#include <string.h>
 #include <macros/byte.h>
 #include <console.h>
 
 #include "PersistCounter.h"
+#include "Crc.h"
+#include "SlotRing.h"
 
 using namespace config;
 
 PersistCounter::PersistCounter(unsigned char size)
   : mValue(0),
-    mSize(size),
-    mSlot(0)
+    mSize(size ? size : 1),
+    mSlot(0),
+    mSequence(0),
+    mHome_p(nullptr),
+    mHomeCursor(0),
+    mFlushIncrements(1),
+    mFlushInterval(0),
+    mPending(0),
+    mFlushedAt(millis()),
+    mDelta(0)
 {
     LOG("PersistCounter (constructor), sz: %u", size);
 }
 
+/* A copy owns no record yet, its first write lays out a whole one */
+PersistCounter::PersistCounter(const PersistCounter &other)
+  : mValue(other.mValue),
+    mSize(other.mSize),
+    mSlot(other.mSlot),
+    mSequence(other.mSequence),
+    mHome_p(nullptr),
+    mHomeCursor(0),
+    mFlushIncrements(other.mFlushIncrements),
+    mFlushInterval(other.mFlushInterval),
+    mPending(other.mPending),
+    mFlushedAt(other.mFlushedAt),
+    mDelta(other.mDelta.load(std::memory_order_relaxed))
+{}
+
+PersistCounter &PersistCounter::operator=(const PersistCounter &other)
+{
+    mValue = other.mValue;
+    mSize = other.mSize;
+    mSlot = other.mSlot;
+    mSequence = other.mSequence;
+    mHome_p = nullptr;
+    mHomeCursor = 0;
+    mFlushIncrements = other.mFlushIncrements;
+    mFlushInterval = other.mFlushInterval;
+    mPending = ASSIGNED;
+    mDelta.store(other.mDelta.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+    return *this;
+}
+
+bool PersistCounter::isHome(const ByteBuffer::iterator &it) const
+{
+    return (it.mBuffer_p == mHome_p) && (it.mCursor == mHomeCursor);
+}
+
+void PersistCounter::setHome(const ByteBuffer::iterator &it)
+{
+    mHome_p = it.mBuffer_p;
+    mHomeCursor = it.mCursor;
+}
+
+void PersistCounter::flushed()
+{
+    mPending = 0;
+    mFlushedAt = millis();
+}
+
+bool PersistCounter::readSlot(const ByteBuffer::iterator &slots, unsigned char slot,
+                              unsigned char &sequence, Type &value)
+{
+    char data[SLOT_SIZE];
+
+    if (slots.mBuffer_p->read(slots + slot * SLOT_SIZE, data, SLOT_SIZE) != SLOT_SIZE)
+    {
+        return false;
+    }
+
+    char checksum = crc8(data, SLOT_SIZE - 1);
+
+    if (checksum != data[SLOT_SIZE - 1])
+    {
+        return false;
+    }
+
+    sequence = data[0];
+    value = 0;
+
+    for (unsigned char ix = 0; ix < sizeof(Type); ++ix)
+    {
+        value |= BYTE_SET(ix, 0x00, data[1 + ix]);
+    }
+
+    return true;
+}
+
+void PersistCounter::writeSlot(const ByteBuffer::iterator &slots, unsigned char slot)
+{
+    char data[SLOT_SIZE];
+
+    data[0] = static_cast<char>(mSequence);
+
+    for (unsigned char ix = 0; ix < sizeof(Type); ++ix)
+    {
+        data[1 + ix] = NBYTE(ix, mValue);
+    }
+
+    data[SLOT_SIZE - 1] = crc8(data, SLOT_SIZE - 1);
+
+    slots.mBuffer_p->write(slots + slot * SLOT_SIZE, data, SLOT_SIZE);
+}
+
 ByteBuffer::iterator PersistCounter::read(ByteBuffer::iterator &it)
+{
+    LOG(" [r] begin: %u", it.mCursor);
+
+    char header[HEADER_SIZE];
+
+    if (it.mBuffer_p->read(it, header, HEADER_SIZE) == HEADER_SIZE)
+    {
+        if ((header[0] == LEGACY_FLAG) && (header[1] == sizeof(Type)))
+        {
+            return readLegacy(it);
+        }
+
+        unsigned char size = header[2];
+
+        if ((header[0] == FLAG) && (header[1] == sizeof(Type)) && (size > 0))
+        {
+            auto slots = it + HEADER_SIZE;
+            unsigned char slot;
+            unsigned char sequence;
+            Type value;
+
+            auto readSequence = [&](unsigned char ix, unsigned char &ixSequence) {
+                return readSlot(slots, ix, ixSequence, value);
+            };
+
+            if (findCurrentSlot(size, readSequence, slot) && readSlot(slots, slot, sequence, value))
+            {
+                mSize = size;
+                mSlot = slot;
+                mSequence = sequence;
+                mValue = value;
+
+                setHome(it);
+                flushed();
+
+                LOG(" [r] size:%u slot:%u value:%u", mSize, mSlot, mValue);
+                return it + recordSize();
+            }
+        }
+    }
+
+    LOG(" [r] not found, use defaults");
+
+    // Set default values otherwise
+    mValue = 0;
+    mSlot = 0;
+    mSequence = 0;
+
+    return it;
+}
+
+ByteBuffer::iterator PersistCounter::readLegacy(ByteBuffer::iterator &it)
 {
     auto nextIt = it;
 
-    LOG(" [r] begin: %u", nextIt.mCursor);
+    char header[HEADER_SIZE];
+    nextIt.mBuffer_p->read(nextIt, header, HEADER_SIZE);
+
+    unsigned char size = header[2];
+    nextIt += HEADER_SIZE;
+
+    /* Slot value followed by the first byte of the next slot */
+    char slot[sizeof(Type) + 1];
 
-    if ((*nextIt++ == FLAG) && (*nextIt++ == sizeof(Type)))
+    for (unsigned char sx = 0; sx < size; ++sx)
     {
-        mSize = *nextIt++;
+        nextIt.mBuffer_p->read(nextIt, slot, sizeof(slot));
+        nextIt += sizeof(Type);
 
-        for (unsigned char sx = 0; sx < mSize; ++sx)
+        if (slot[sizeof(Type)] == LEGACY_FLAG)
         {
+            mValue = 0;
+
             for (unsigned char ix = 0; ix < sizeof(Type); ++ix)
             {
-                mValue |= BYTE_SET(ix, 0x00, *nextIt++);
+                mValue |= BYTE_SET(ix, 0x00, slot[ix]);
             }
 
-            if (*nextIt == FLAG)
-            {
-                mSlot = sx;
+            /* No home: the next write lays out the current format */
+            mSize = size;
+            mSlot = 0;
+            mSequence = 0;
 
-                LOG(" [r] size:%u slot:%u value:%u", mSize, mSlot, mValue);
+            flushed();
 
-                // Skip rest slots and flag
-                nextIt += ((mSize - 1) - sx) * sizeof(Type) + 1;
+            LOG(" [r] legacy size:%u value:%u", mSize, mValue);
 
-                LOG(" [r] end: %u", nextIt.mCursor);
-                return nextIt;
-            }
+            // Skip rest slots and flag
+            return nextIt + (((size - 1) - sx) * sizeof(Type) + 1);
         }
     }
 
     LOG(" [r] not found, use defaults");
 
-    // Set default values otherwise
     mValue = 0;
     mSlot = 0;
+    mSequence = 0;
 
-    LOG(" [r] end: %u", it.mCursor);
     return it;
 }
 
 ByteBuffer::iterator PersistCounter::write(ByteBuffer::iterator &it)
 {
-    auto nextIt = it;
+    LOG(" [w] begin: %u", it.mCursor);
 
-    LOG(" [w] begin: %u", nextIt.mCursor);
+    drain();
 
-    *nextIt++ = FLAG;
-    *nextIt++ = sizeof(Type);
-    *nextIt++ = mSize;
+    auto slots = it + HEADER_SIZE;
+    const char header[HEADER_SIZE] = { FLAG, sizeof(Type), static_cast<char>(mSize) };
 
-    mValue %= PersistCounter::MASK;
-    mSlot = (mSlot + 1) % mSize;
+    if (isHome(it))
+    {
+        /* Unless the record was overwritten since */
+        char present[HEADER_SIZE];
 
-    LOG(" [w] size:%u slot:%u value:%u", mSize, mSlot, mValue);
+        if ((it.mBuffer_p->read(it, present, HEADER_SIZE) == HEADER_SIZE) &&
+            (memcmp(present, header, HEADER_SIZE) == 0))
+        {
+            mSlot = (mSlot + 1) % mSize;
+            ++mSequence;
 
-    nextIt += mSlot * sizeof(Type);
+            writeSlot(slots, mSlot);
+            flushed();
 
-    for (unsigned char ix = 0; ix < sizeof(Type); ++ix)
+            LOG(" [w] slot:%u value:%u", mSlot, mValue);
+            return it + recordSize();
+        }
+    }
+
+    it.mBuffer_p->write(it, header, HEADER_SIZE);
+
+    char erased[8 * SLOT_SIZE];
+    memset(erased, ERASED, sizeof(erased));
+
+    for (unsigned short offset = SLOT_SIZE; offset < mSize * SLOT_SIZE; offset += sizeof(erased))
     {
-        *nextIt++ = NBYTE(ix, mValue);
+        unsigned short length = mSize * SLOT_SIZE - offset;
+
+        it.mBuffer_p->write(slots + offset, erased, (length < sizeof(erased)) ? length : sizeof(erased));
     }
 
-    *nextIt++ = FLAG;
+    mSlot = 0;
+    mSequence = 0;
+
+    writeSlot(slots, mSlot);
+    setHome(it);
+    flushed();
+
+    LOG(" [w] size:%u value:%u, whole record", mSize, mValue);
+    return it + recordSize();
+}
+
+unsigned short PersistCounter::recordSize() const
+{
+    return HEADER_SIZE + mSize * SLOT_SIZE;
+}
+
+void PersistCounter::setFlushPolicy(Type increments, unsigned long interval)
+{
+    mFlushIncrements = increments;
+    mFlushInterval = interval;
+}
+
+PersistCounter::Type PersistCounter::pending() const
+{
+    Type delta = mDelta.load(std::memory_order_relaxed);
+
+    return (delta < ASSIGNED - mPending) ? mPending + delta : ASSIGNED;
+}
+
+bool PersistCounter::isFlushDue() const
+{
+    Type pending = this->pending();
 
-    // Skip next slots
-    nextIt += ((mSize - 1) - mSlot) * sizeof(Type);
+    if (!pending)
+    {
+        return false;
+    }
+
+    if ((pending == ASSIGNED) || (mFlushIncrements && (pending >= mFlushIncrements)))
+    {
+        return true;
+    }
 
-    LOG(" [w] end: %u", nextIt.mCursor);
-    return nextIt;
+    return mFlushInterval && (millis() - mFlushedAt >= mFlushInterval);
 }
 
 PersistCounter &PersistCounter::operator++()
 {
     ++mValue;
+
+    if (mPending != ASSIGNED)
+    {
+        ++mPending;
+    }
+
     return *this;
 }
 
 PersistCounter &PersistCounter::operator+=(Type value)
 {
     mValue += value;
+    mPending = (value < ASSIGNED - mPending) ? mPending + value : ASSIGNED;
+
     return *this;
 }
 
+void IRAM_ATTR PersistCounter::accumulate(Type count)
+{
+#if CONFIG_PLATFORM_HOST
+    /* Only the sum matters, no ordering with other memory */
+    mDelta.fetch_add(count, std::memory_order_relaxed);
+#else
+    /* Single core: a plain add with the interrupts masked, no atomic
+     * helper in flash. The level is restored, so it nests in an ISR. */
+    uint32_t state = xt_rsil(15);
+    mDelta.store(mDelta.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    xt_wsr_ps(state);
+#endif
+}
+
+PersistCounter::Type PersistCounter::drain()
+{
+#if CONFIG_PLATFORM_HOST
+    Type delta = mDelta.exchange(0, std::memory_order_relaxed);
+#else
+    uint32_t state = xt_rsil(15);
+    Type delta = mDelta.load(std::memory_order_relaxed);
+    mDelta.store(0, std::memory_order_relaxed);
+    xt_wsr_ps(state);
+#endif
+
+    if (delta)
+    {
+        mValue += delta;
+        mPending = (delta < ASSIGNED - mPending) ? mPending + delta : ASSIGNED;
+    }
+
+    return delta;
+}
+
 PersistCounter &PersistCounter::operator=(const Type &value)
 {
     mValue = value;
+    mPending = ASSIGNED;
+    mDelta.store(0, std::memory_order_relaxed);
+
     return *this;
 }
 
 PersistCounter::operator Type() const
 {
-    return mValue;
+    return mValue + mDelta.load(std::memory_order_relaxed);
 }
 
 const PersistCounter::Type& PersistCounter::get()
@@ -125,5 +388,7 @@ const PersistCounter::Type& PersistCounter::get()
 
 void PersistCounter::set(PersistCounter::Type value)
 {
-    mValue = value % MASK;
+    mValue = value;
+    mPending = ASSIGNED;
+    mDelta.store(0, std::memory_order_relaxed);
 }
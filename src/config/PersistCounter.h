@@ -10,11 +10,37 @@
 #pragma once
 
 #include <Arduino.h>
+#include <atomic>
+#include <limits>
 
 #include "ByteBuffer.h"
 
 namespace config
 {
+    /* Counter spread over a ring of slots to level the wear.
+     *
+     *   header:  FLAG, sizeof(Type), size
+     *   slot:    sequence, value (little endian), CRC8 of both
+     *
+     * Each write fills the slot after the current one with the next
+     * sequence number, read finds the current slot by binary search (see
+     * SlotRing.h). An erased or torn slot breaks the sequence.
+     *
+     * Once the counter has read or written the record at a position, a
+     * write there only fills the next slot. Anywhere else it writes the
+     * whole record: header, the slot and erased slots.
+     *
+     * The running value lives in RAM, the flush policy tells the owner
+     * when to persist it (isFlushDue, then Config::flush or write). With
+     * a flush every N increments at most N - 1 counts are lost by a reset;
+     * with an interval of T ms at most the counts of the last T ms plus
+     * the time between two checks. A shutdown or brownout hook writes
+     * unconditionally and loses nothing.
+     *
+     * Interrupt handlers and other threads count through accumulate(),
+     * which only adds to a separate delta. The persisting side moves the
+     * delta into the value with drain(); write() drains first. The other
+     * operators are for the owner of the counter only. */
     class PersistCounter
     {
     public:
@@ -24,29 +50,90 @@ namespace config
         explicit PersistCounter(unsigned char size);
         ~PersistCounter() = default;
 
-        PersistCounter(const PersistCounter &) = default;
+        PersistCounter(const PersistCounter &);
+        PersistCounter &operator=(const PersistCounter &);
 
+        /* Value with the counts accumulated since the last drain */
         operator Type() const;
         PersistCounter &operator=(const Type &value);
 
         PersistCounter &operator++();
         PersistCounter &operator+=(Type value);
 
+        /* Safe from interrupts and other threads: an atomic add on the
+         * host, a plain add with the interrupts masked on the device.
+         * Placed in IRAM and calling nothing in flash, so an ISR can call
+         * it while the flash cache is off (e.g. during an EEPROM commit). */
+        void accumulate(Type count = 1);
+
+        /* Adds the accumulated counts to the value, returns them */
+        Type drain();
+
         ByteBuffer::iterator read(ByteBuffer::iterator &it);
         ByteBuffer::iterator write(ByteBuffer::iterator &it);
 
+        /* Header and slots */
+        unsigned short recordSize() const;
+
+        /* Flush once increments counts are pending or interval ms after
+         * the last flush with counts pending, 0 disables a rule. The
+         * default flushes every increment. */
+        void setFlushPolicy(Type increments, unsigned long interval = 0);
+
+        /* Counts changed or accumulated since the last read or write. An
+         * assignment drops the accumulated counts and makes the flush due
+         * at once. */
+        Type pending() const;
+        bool isFlushDue() const;
+
+        /* Value without them, as written */
         const Type& get();
         void set(Type value);
 
+        /* The record at it is the one last read or written, in the slot
+         * format: each slot carries its CRC8 */
+        bool isHome(const ByteBuffer::iterator &it) const;
+
     private:
-        static constexpr char FLAG = 0x80;
-        static constexpr Type MASK = (Type)(-1UL) >> 2;
+        static constexpr char FLAG = 0x81;
+        static constexpr char LEGACY_FLAG = 0x80;
+        static constexpr unsigned char HEADER_SIZE = 3;  /* flag, sizeof(Type), size */
+        static constexpr unsigned char SLOT_SIZE = 1 + sizeof(Type) + 1;
+        static constexpr char ERASED = static_cast<char>(0xFF);
+        static constexpr Type ASSIGNED = std::numeric_limits<Type>::max();
+
+        /* Sequence and value of a valid slot */
+        bool readSlot(const ByteBuffer::iterator &slots, unsigned char slot,
+                      unsigned char &sequence, Type &value);
+        void writeSlot(const ByteBuffer::iterator &slots, unsigned char slot);
+
+        /* Record of the previous format: the current slot is followed by
+         * the flag */
+        ByteBuffer::iterator readLegacy(ByteBuffer::iterator &it);
+
+        void setHome(const ByteBuffer::iterator &it);
+
+        /* Value persisted or read, nothing pending */
+        void flushed();
 
     private:
         Type mValue;
 
         unsigned char mSize;
         unsigned char mSlot;
+        unsigned char mSequence;
+
+        /* Record position of the last read or write */
+        ByteBuffer* mHome_p;
+        unsigned short mHomeCursor;
+
+        Type mFlushIncrements;
+        unsigned long mFlushInterval;
+        Type mPending;
+        unsigned long mFlushedAt;
+
+        /* Counts of accumulate() not drained yet */
+        std::atomic<Type> mDelta;
     };
 
 } // namespace
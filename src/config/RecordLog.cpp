@@ -0,0 +1,458 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <algorithm>
+#include <string.h>
+#include <console.h>
+
+#include "RecordLog.h"
+#include "Crc.h"
+
+using namespace console;
+using namespace config;
+
+// Struct RecordLog::Stats
+
+float RecordLog::Stats::writeAmplification() const {
+
+    return valueBytes ? static_cast<float>(writtenBytes) / valueBytes : 0.0f;
+}
+
+// Class RecordLog
+
+RecordLog::RecordLog(ByteBuffer& buffer, unsigned short offset, unsigned short size)
+    : mBuffer(buffer),
+      mOffset(offset),
+      mBankSize(((size ? size : buffer.size() - offset)) / 2),
+      mBank(0),
+      mGeneration(0),
+      mEnd(0),
+      mIsPending(false),
+      mScratch(mBankSize),
+      mStats() {
+
+    mLatest.fill(NO_RECORD);
+}
+
+unsigned short RecordLog::bankBegin(unsigned char bank) const {
+
+    return mOffset + bank * mBankSize;
+}
+
+unsigned short RecordLog::bankEnd(unsigned char bank) const {
+
+    return bankBegin(bank) + mBankSize;
+}
+
+unsigned long RecordLog::readHeader(unsigned char bank) {
+
+    char header[BANK_HEADER_SIZE];
+
+    mBuffer.read(mBuffer.begin() + bankBegin(bank), header, BANK_HEADER_SIZE);
+
+    if ((static_cast<unsigned char>(header[0]) != MAGIC_0) ||
+        (static_cast<unsigned char>(header[1]) != MAGIC_1) ||
+        (static_cast<char>(crc8(header, BANK_HEADER_SIZE - 1)) !=
+         header[BANK_HEADER_SIZE - 1])) {
+        return 0;
+    }
+
+    unsigned long generation = 0;
+
+    for (unsigned char ix = 0; ix < 4; ++ix) {
+        generation |= BYTE_SET(ix, 0x00, header[2 + ix]);
+    }
+
+    return generation;
+}
+
+void RecordLog::writeHeader(unsigned char bank, unsigned long generation) {
+
+    char header[BANK_HEADER_SIZE] = { static_cast<char>(MAGIC_0), static_cast<char>(MAGIC_1) };
+
+    for (unsigned char ix = 0; ix < 4; ++ix) {
+        header[2 + ix] = NBYTE(ix, generation);
+    }
+
+    header[BANK_HEADER_SIZE - 1] = crc8(header, BANK_HEADER_SIZE - 1);
+
+    mBuffer.write(mBuffer.begin() + bankBegin(bank), header, BANK_HEADER_SIZE);
+    mStats.writtenBytes += BANK_HEADER_SIZE;
+}
+
+void RecordLog::erase(unsigned char bank) {
+
+    char erased[64];
+    memset(erased, ERASED, sizeof(erased));
+
+    for (unsigned short offset = bankBegin(bank); offset < bankEnd(bank); offset += sizeof(erased)) {
+
+        unsigned short length = std::min<unsigned short>(sizeof(erased), bankEnd(bank) - offset);
+
+        mBuffer.write(mBuffer.begin() + offset, erased, length);
+    }
+
+    mStats.erasedBytes += mBankSize;
+}
+
+bool RecordLog::mount() {
+
+    if (mBankSize < BANK_HEADER_SIZE + RECORD_HEADER_SIZE + 1) {
+        LOG("Log region too small: %u", mBankSize);
+        return false;
+    }
+
+    unsigned long generations[2] = { readHeader(0), readHeader(1) };
+
+    if (!generations[0] && !generations[1]) {
+
+        LOG("Format log");
+
+        erase(0);
+        writeHeader(0, 1);
+        mBuffer.commit();
+
+        generations[0] = 1;
+    }
+
+    mBank = (generations[1] > generations[0]) ? 1 : 0;
+    mGeneration = generations[mBank];
+
+    scan();
+
+    return true;
+}
+
+bool RecordLog::readRecord(unsigned short offset, unsigned short& length) {
+
+    if (offset + RECORD_HEADER_SIZE + 1 > bankEnd(mBank)) {
+        return false;
+    }
+
+    char header[RECORD_HEADER_SIZE];
+
+    mBuffer.read(mBuffer.begin() + offset, header, RECORD_HEADER_SIZE);
+
+    if (static_cast<unsigned char>(header[0]) == ERASED) {
+        return false;
+    }
+
+    length = BYTE_SET(0, 0x00, header[2]) | BYTE_SET(1, 0x00, header[3]);
+
+    unsigned short size = RECORD_HEADER_SIZE + length + 1;
+
+    if (offset + size > bankEnd(mBank)) {
+        return false;
+    }
+
+    mBuffer.read(mBuffer.begin() + offset, scratch(), size);
+
+    const char* record_p = mScratch.data();
+
+    return static_cast<char>(crc8(record_p, size - 1)) == record_p[size - 1];
+}
+
+bool RecordLog::checkRecord(unsigned short offset, unsigned short& length) {
+
+    if (offset + RECORD_HEADER_SIZE + 1 > bankEnd(mBank)) {
+        return false;
+    }
+
+    char chunk[32];
+
+    mBuffer.read(mBuffer.begin() + offset, chunk, RECORD_HEADER_SIZE);
+
+    if (static_cast<unsigned char>(chunk[0]) == ERASED) {
+        return false;
+    }
+
+    length = BYTE_SET(0, 0x00, chunk[2]) | BYTE_SET(1, 0x00, chunk[3]);
+
+    unsigned short size = RECORD_HEADER_SIZE + length + 1;
+
+    if (offset + size > bankEnd(mBank)) {
+        return false;
+    }
+
+    unsigned char crc = 0;
+
+    for (unsigned short done = 0; done < size - 1; done += sizeof(chunk)) {
+
+        unsigned short count = std::min<unsigned short>(sizeof(chunk), size - 1 - done);
+
+        mBuffer.read(mBuffer.begin() + offset + done, chunk, count);
+        crc = crc8(chunk, count, crc);
+    }
+
+    mBuffer.read(mBuffer.begin() + offset + size - 1, chunk, 1);
+
+    return static_cast<char>(crc) == chunk[0];
+}
+
+void RecordLog::copy(unsigned short from, unsigned short to, unsigned short size) {
+
+    char chunk[32];
+
+    for (unsigned short done = 0; done < size; done += sizeof(chunk)) {
+
+        unsigned short count = std::min<unsigned short>(sizeof(chunk), size - done);
+
+        mBuffer.read(mBuffer.begin() + from + done, chunk, count);
+        mBuffer.write(mBuffer.begin() + to + done, chunk, count);
+    }
+}
+
+void RecordLog::scan() {
+
+    mLatest.fill(NO_RECORD);
+
+    unsigned short offset = bankBegin(mBank) + BANK_HEADER_SIZE;
+    unsigned short length;
+
+    while (readRecord(offset, length)) {
+
+        mLatest[static_cast<unsigned char>(mScratch.data()[0])] = offset;
+        offset += RECORD_HEADER_SIZE + length + 1;
+    }
+
+    mEnd = offset;
+
+    LOG("Log bank %u, generation %lu, %u bytes used", mBank, mGeneration, mEnd - bankBegin(mBank));
+}
+
+char* RecordLog::scratch() {
+
+    /* The vector behind mScratch, data() only hands it out read-only */
+    return const_cast<char*>(mScratch.data());
+}
+
+void RecordLog::commit() {
+
+    if (!mIsPending) {
+        return;
+    }
+
+    mBuffer.commit();
+    mIsPending = false;
+}
+
+unsigned short RecordLog::available() const {
+
+    return bankEnd(mBank) - mEnd;
+}
+
+bool RecordLog::contains(unsigned char id) const {
+
+    return mLatest[id] != NO_RECORD;
+}
+
+unsigned short RecordLog::liveSize() {
+
+    unsigned short live = 0;
+
+    for (unsigned short id = 0; id < mLatest.size(); ++id) {
+
+        if (mLatest[id] == NO_RECORD) {
+            continue;
+        }
+
+        char header[RECORD_HEADER_SIZE];
+
+        mBuffer.read(mBuffer.begin() + mLatest[id], header, RECORD_HEADER_SIZE);
+
+        live += RECORD_HEADER_SIZE + (BYTE_SET(0, 0x00, header[2]) | BYTE_SET(1, 0x00, header[3])) + 1;
+    }
+
+    return live;
+}
+
+bool RecordLog::reserve(unsigned short size) {
+
+    if (size <= available()) {
+        return true;
+    }
+
+    /* Compaction keeps the newest records, no use if they leave no room */
+    if (liveSize() + size > mBankSize - BANK_HEADER_SIZE) {
+        return false;
+    }
+
+    return compact() && (size <= available());
+}
+
+bool RecordLog::isLatest(unsigned char id, ConfigParameterType type, const char* value_p, unsigned short length) {
+
+    unsigned short offset = mLatest[id];
+
+    if (offset == NO_RECORD) {
+        return false;
+    }
+
+    char header[RECORD_HEADER_SIZE];
+
+    mBuffer.read(mBuffer.begin() + offset, header, RECORD_HEADER_SIZE);
+
+    if ((header[1] != static_cast<char>(type)) ||
+        ((BYTE_SET(0, 0x00, header[2]) | BYTE_SET(1, 0x00, header[3])) != length)) {
+        return false;
+    }
+
+    /* The scratch may hold the value, compare through a small buffer */
+    char chunk[16];
+    offset += RECORD_HEADER_SIZE;
+
+    for (unsigned short done = 0; done < length; done += sizeof(chunk)) {
+
+        unsigned short count = std::min<unsigned short>(sizeof(chunk), length - done);
+
+        mBuffer.read(mBuffer.begin() + offset + done, chunk, count);
+
+        if (memcmp(chunk, value_p + done, count) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool RecordLog::append(unsigned char id, ConfigParameterType type, const char* value_p, unsigned short length) {
+
+    unsigned short size = RECORD_HEADER_SIZE + length + 1;
+
+    if ((id != ConfigParameterBase::INVALID_ID) && isLatest(id, type, value_p, length)) {
+        ++mStats.unchanged;
+        return true;
+    }
+
+    if ((id == ConfigParameterBase::INVALID_ID) || !reserve(size)) {
+        LOG("Log full: id=%d, %u bytes", id, size);
+        return false;
+    }
+
+    char* record_p = scratch();
+
+    /* value_p may point into the scratch record already */
+    memmove(record_p + RECORD_HEADER_SIZE, value_p, length);
+
+    record_p[0] = static_cast<char>(id);
+    record_p[1] = static_cast<char>(type);
+    record_p[2] = NBYTE(0, length);
+    record_p[3] = NBYTE(1, length);
+    record_p[size - 1] = crc8(record_p, size - 1);
+
+    mBuffer.write(mBuffer.begin() + mEnd, record_p, size);
+
+    mLatest[id] = mEnd;
+    mEnd += size;
+    mIsPending = true;
+
+    ++mStats.appends;
+    mStats.valueBytes += length;
+    mStats.writtenBytes += size;
+
+    return true;
+}
+
+bool RecordLog::append(ConfigParameterBase& parameter) {
+
+    /* Encoded behind the record header: id and type are overwritten by
+     * the length, the value is then in place */
+    unsigned short size = RECORD_HEADER_SIZE + (parameter.recordSize() - 2) + 1;
+
+    if (size > mScratch.size()) {
+        LOG("Log full: id=%d, %u bytes", parameter.getId(), size);
+        return false;
+    }
+
+    /* Codecs may skip bytes (counter slots), they read back as erased */
+    memset(scratch(), ERASED, size);
+
+    auto it = mScratch.begin() + (RECORD_HEADER_SIZE - 2);
+    auto nextIt = parameter.write(it);
+
+    unsigned short length = (nextIt - it) - 2;
+
+    /* Compaction leaves the scratch alone, the value stays in place */
+    return append(parameter.getId(), parameter.getType(), mScratch.data() + RECORD_HEADER_SIZE, length);
+}
+
+bool RecordLog::load(ConfigParameterBase& parameter) {
+
+    unsigned short offset = mLatest[parameter.getId()];
+    unsigned short length;
+
+    if ((offset == NO_RECORD) || !readRecord(offset, length)) {
+        return false;
+    }
+
+    /* id and type in front of the value make the parameter record */
+    char* record_p = scratch();
+
+    record_p[2] = record_p[0];
+    record_p[3] = record_p[1];
+
+    auto it = mScratch.begin() + (RECORD_HEADER_SIZE - 2);
+
+    return parameter.read(it) != it;
+}
+
+bool RecordLog::compact() {
+
+    unsigned char target = mBank ^ 1;
+    unsigned short offset = bankBegin(target) + BANK_HEADER_SIZE;
+    std::array<unsigned short, 256> latest;
+
+    latest.fill(NO_RECORD);
+
+    erase(target);
+
+    for (unsigned short id = 0; id < mLatest.size(); ++id) {
+
+        unsigned short length;
+
+        if ((mLatest[id] == NO_RECORD) || !checkRecord(mLatest[id], length)) {
+            continue;
+        }
+
+        unsigned short size = RECORD_HEADER_SIZE + length + 1;
+
+        copy(mLatest[id], offset, size);
+
+        latest[id] = offset;
+        offset += size;
+
+        mStats.writtenBytes += size;
+        mStats.compactedBytes += size;
+    }
+
+    /* The new bank is valid from here on */
+    writeHeader(target, mGeneration + 1);
+    mBuffer.commit();
+
+    ++mStats.compactions;
+
+    mBank = target;
+    mGeneration += 1;
+    mEnd = offset;
+    mLatest = latest;
+
+    LOG("Log compacted into bank %u: %u bytes used", mBank, mEnd - bankBegin(mBank));
+
+    return true;
+}
+
+const RecordLog::Stats& RecordLog::stats() const {
+
+    return mStats;
+}
+
+void RecordLog::resetStats() {
+
+    mStats = Stats();
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#pragma once
+
+#include <array>
+
+#include "ByteBuffer.h"
+#include "ConfigParameter.h"
+#include "StorageMemory.h"
+
+namespace config {
+
+/* Append-only parameter log over a region of a ByteBuffer.
+ *
+ * The region is split in two banks, one of them active:
+ *
+ *   bank:    magic (2), generation (4), CRC8, records..., erased (0xFF)
+ *   record:  id, type, length (2), value, CRC8 of all before it
+ *
+ * Every update appends a record, the newest valid one of an id wins.
+ * When the active bank is full, compact() erases the other bank, copies
+ * the newest record of each id into it and writes its header with the
+ * next generation last: until then the old bank stays the valid one.
+ * A record torn by a reset fails its CRC and ends the log.
+ *
+ * The value of a parameter record is its ConfigParameter encoding
+ * without id and type, so any parameter type can be logged. */
+class RecordLog {
+public:
+    struct Stats {
+        unsigned long appends;
+        unsigned long unchanged;       /* appends equal to the newest record */
+        unsigned long valueBytes;      /* value bytes requested by appends */
+        unsigned long writtenBytes;    /* records, headers and copies */
+        unsigned long erasedBytes;
+        unsigned long compactions;
+        unsigned long compactedBytes;  /* live records copied */
+
+        /* Bytes written per value byte */
+        float writeAmplification() const;
+    };
+
+    /* size 0: up to the end of buffer */
+    RecordLog(ByteBuffer& buffer, unsigned short offset = 0, unsigned short size = 0);
+    ~RecordLog() = default;
+
+    RecordLog(RecordLog const&) = delete;
+    RecordLog& operator= (RecordLog const&) = delete;
+
+    /* Finds the active bank and indexes its records, formats the region
+     * if neither bank is valid. false if the region is too small. */
+    bool mount();
+
+    /* Appends the value, compacting the log first if it does not fit;
+     * false if even the newest records alone leave no room for it. A
+     * value equal to the newest record of id is not appended again.
+     * Appended records reach the storage on commit(). */
+    bool append(unsigned char id, ConfigParameterType type, const char* value_p, unsigned short length);
+    bool append(ConfigParameterBase& parameter);
+
+    /* Reads the newest record of the parameter id */
+    bool load(ConfigParameterBase& parameter);
+
+    bool contains(unsigned char id) const;
+
+    /* Rewrites the newest records into the other bank, commits */
+    bool compact();
+
+    /* Commits the buffer if anything was appended since */
+    void commit();
+
+    /* Bytes left in the active bank */
+    unsigned short available() const;
+
+    const Stats& stats() const;
+    void resetStats();
+
+private:
+    static constexpr unsigned char MAGIC_0 = 0x4C;  /* 'L' */
+    static constexpr unsigned char MAGIC_1 = 0x47;  /* 'G' */
+    static constexpr unsigned short BANK_HEADER_SIZE = 7;
+    static constexpr unsigned short RECORD_HEADER_SIZE = 4;  /* id, type, length */
+    static constexpr unsigned short NO_RECORD = 0xFFFF;
+    static constexpr unsigned char ERASED = 0xFF;
+
+    /* Generation of a valid bank header, 0 otherwise */
+    unsigned long readHeader(unsigned char bank);
+    void writeHeader(unsigned char bank, unsigned long generation);
+
+    void erase(unsigned char bank);
+    void scan();
+
+    unsigned short bankBegin(unsigned char bank) const;
+    unsigned short bankEnd(unsigned char bank) const;
+
+    /* Record at the absolute offset into the scratch, false if it is
+     * erased, cut or has an invalid CRC */
+    bool readRecord(unsigned short offset, unsigned short& length);
+
+    /* readRecord() through a small buffer, the scratch is left alone */
+    bool checkRecord(unsigned short offset, unsigned short& length);
+
+    /* Copies size bytes between absolute offsets through a small buffer */
+    void copy(unsigned short from, unsigned short to, unsigned short size);
+
+    /* The newest record of id holds this value */
+    bool isLatest(unsigned char id, ConfigParameterType type, const char* value_p, unsigned short length);
+
+    char* scratch();
+
+    /* Bytes of the newest records, what a compaction keeps */
+    unsigned short liveSize();
+
+    /* Room for size bytes in the active bank, compacts if needed and if
+     * the live records leave room for them */
+    bool reserve(unsigned short size);
+
+private:
+    ByteBuffer& mBuffer;
+    unsigned short mOffset;
+    unsigned short mBankSize;
+
+    unsigned char mBank;
+    unsigned long mGeneration;
+    unsigned short mEnd;    /* absolute offset of the next record */
+    bool mIsPending;        /* appended since the last commit */
+
+    /* id -> absolute offset of its newest record */
+    std::array<unsigned short, 256> mLatest;
+
+    /* Record being encoded or decoded */
+    StorageMemory mScratch;
+
+    Stats mStats;
+};
+
+} // namespace
@@ -0,0 +1,287 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <utility>
+#include <IPAddress.h>
+
+#include "ByteBuffer.h"
+#include "Crc.h"
+#include "ConfigParameter.h"
+#include "ImageToc.h"
+
+namespace config {
+
+/* Fixed size encoding of the schema value types, the payload layout is
+ * the one of the matching ConfigParameter<T> record. */
+template <typename T>
+struct SchemaCodec;
+
+template <>
+struct SchemaCodec<char> {
+    static constexpr unsigned char SIZE = sizeof(char);
+
+    static void encode(const char& value, char* payload_p) { payload_p[0] = value; }
+    static char decode(const char* payload_p) { return payload_p[0]; }
+};
+
+template <>
+struct SchemaCodec<int> {
+    static constexpr unsigned char SIZE = sizeof(int);
+
+    static void encode(const int& value, char* payload_p) {
+        for (unsigned char ix = 0; ix < SIZE; ++ix) {
+            payload_p[ix] = NBYTE(ix, value);
+        }
+    }
+
+    static int decode(const char* payload_p) {
+        int value = 0;
+        for (unsigned char ix = 0; ix < SIZE; ++ix) {
+            value |= BYTE_SET(ix, 0x00, payload_p[ix]);
+        }
+        return value;
+    }
+};
+
+template <>
+struct SchemaCodec<IPAddress> {
+    static constexpr unsigned char SIZE = sizeof(uint32_t);
+
+    static void encode(const IPAddress& value, char* payload_p) {
+        uint32_t address = static_cast<uint32_t>(value);
+        for (unsigned char ix = 0; ix < SIZE; ++ix) {
+            payload_p[ix] = NBYTE(ix, address);
+        }
+    }
+
+    static IPAddress decode(const char* payload_p) {
+        uint32_t address = 0;
+        for (unsigned char ix = 0; ix < SIZE; ++ix) {
+            address |= BYTE_SET(ix, 0x00, payload_p[ix]);
+        }
+        return IPAddress(address);
+    }
+};
+
+/* Parameter of a Schema: id, value type and default value */
+template <unsigned char Id, typename T, auto Default = 0>
+struct Param {
+    using Type = T;
+    using Codec = SchemaCodec<T>;
+
+    static constexpr unsigned char ID = Id;
+    static constexpr ConfigParameterType TYPE = ConfigParameterTypeOf<T>::value;
+
+    /* id, type, payload, checksum */
+    static constexpr unsigned short RECORD_SIZE = 2 + Codec::SIZE + 1;
+
+    static T defaultValue() { return T(Default); }
+};
+
+template <typename... Params>
+constexpr std::array<unsigned short, sizeof...(Params)> schemaOffsets(unsigned short offset) {
+    std::array<unsigned short, sizeof...(Params)> offsets{};
+    unsigned short sizes[] = { Params::RECORD_SIZE... };
+
+    for (std::size_t ix = 0; ix < sizeof...(Params); ++ix) {
+        offsets[ix] = offset;
+        offset += sizes[ix];
+    }
+
+    return offsets;
+}
+
+template <std::size_t Count>
+constexpr std::size_t schemaIndexOf(const std::array<unsigned char, Count>& ids, unsigned char id) {
+    for (std::size_t ix = 0; ix < Count; ++ix) {
+        if (ids[ix] == id) {
+            return ix;
+        }
+    }
+
+    return Count;
+}
+
+template <std::size_t Count>
+constexpr bool schemaIsAscending(const std::array<unsigned char, Count>& ids) {
+    for (std::size_t ix = 1; ix < Count; ++ix) {
+        if (ids[ix - 1] >= ids[ix]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Parameter set known at compile time.
+ *
+ * Record offsets and the image size are constants, the values live in one
+ * object (declare it static) and read/write are inlined per parameter with
+ * no virtual calls or heap allocation, except one block transfer to the
+ * buffer. Ids must be ascending: the image is then the one Config writes
+ * for the same parameters, table of contents included. Legacy images
+ * without the table are read as well. */
+template <typename... Params>
+class Schema {
+public:
+    static constexpr std::size_t COUNT = sizeof...(Params);
+    static constexpr unsigned short TOC_SIZE = ImageToc::size(COUNT);
+    static constexpr unsigned short SIZE = TOC_SIZE + (Params::RECORD_SIZE + ... + 0);
+
+    Schema() : mValues(Params::defaultValue()...) {}
+
+    /* Record offset from the image begin */
+    template <unsigned char Id>
+    static constexpr unsigned short offset() {
+        static_assert(indexOf(Id) < COUNT, "Id is not in the schema");
+        return OFFSETS[indexOf(Id)];
+    }
+
+    template <unsigned char Id>
+    auto& get() {
+        static_assert(indexOf(Id) < COUNT, "Id is not in the schema");
+        return std::get<indexOf(Id)>(mValues);
+    }
+
+    template <unsigned char Id, typename T>
+    void set(const T& value) {
+        get<Id>() = value;
+    }
+
+    /* image_p holds SIZE bytes */
+    void serialize(char* image_p) const {
+        serialize(image_p, std::index_sequence_for<Params...>());
+    }
+
+    /* Records which do not match keep their value, returns false then.
+     * image_p holds SIZE bytes, or SIZE - TOC_SIZE for legacy images. */
+    bool deserialize(const char* image_p) {
+        if ((static_cast<unsigned char>(image_p[0]) != ImageToc::MAGIC_0) ||
+            ((static_cast<unsigned char>(image_p[1]) != ImageToc::MAGIC_1) &&
+             (static_cast<unsigned char>(image_p[1]) != ImageToc::MAGIC_1_CRC))) {
+            return deserialize(image_p, TOC_SIZE, std::index_sequence_for<Params...>());
+        }
+
+        return deserialize(image_p, 0, std::index_sequence_for<Params...>());
+    }
+
+    /* Image at the buffer begin */
+    Schema& write(ByteBuffer& buffer) {
+        char image[SIZE];
+
+        serialize(image);
+
+        buffer.write(buffer.begin(), image, SIZE);
+        buffer.commit();
+
+        return *this;
+    }
+
+    bool read(ByteBuffer& buffer) {
+        auto it = buffer.begin();
+
+        if (buffer.remaining(it) < SIZE - TOC_SIZE) {
+            return false;
+        }
+
+        if (buffer.remaining(it) < SIZE) {
+            /* Only a legacy image fits */
+            char image[SIZE - TOC_SIZE];
+            buffer.read(it, image, sizeof(image));
+
+            return deserialize(image);
+        }
+
+        if (it.data()) {
+            return deserialize(it.data());
+        }
+
+        char image[SIZE];
+        buffer.read(it, image, SIZE);
+
+        return deserialize(image);
+    }
+
+private:
+    static constexpr std::array<unsigned char, COUNT> IDS = { Params::ID... };
+    static constexpr std::array<unsigned short, COUNT> OFFSETS = schemaOffsets<Params...>(TOC_SIZE);
+
+    static constexpr std::size_t indexOf(unsigned char id) {
+        return schemaIndexOf(IDS, id);
+    }
+
+    static_assert(schemaIsAscending(IDS), "Schema ids must be unique and ascending");
+    static_assert(((Params::TYPE != ConfigParameterType::INVALID) && ...), "Not a parameter type");
+
+    template <typename P>
+    static void encode(char* record_p, const typename P::Type& value) {
+        record_p[0] = static_cast<char>(P::ID);
+        record_p[1] = static_cast<char>(P::TYPE);
+
+        P::Codec::encode(value, record_p + 2);
+
+        record_p[2 + P::Codec::SIZE] = crc8(record_p + 2, P::Codec::SIZE);
+    }
+
+    template <typename P>
+    static bool decode(const char* record_p, typename P::Type& value) {
+        if ((static_cast<unsigned char>(record_p[0]) != P::ID) ||
+            (record_p[1] != static_cast<char>(P::TYPE))) {
+            return false;
+        }
+
+        char checksum = crc8(record_p + 2, P::Codec::SIZE);
+
+        if (checksum != record_p[2 + P::Codec::SIZE]) {
+            return false;
+        }
+
+        value = P::Codec::decode(record_p + 2);
+        return true;
+    }
+
+    /* Same as ImageToc::writeHeader/writeEntry */
+    static void encodeToc(char* image_p) {
+        image_p[0] = static_cast<char>(ImageToc::MAGIC_0);
+        image_p[1] = static_cast<char>(ImageToc::MAGIC_1);
+        image_p[2] = static_cast<char>(COUNT);
+        image_p[3] = NBYTE(0, SIZE);
+        image_p[4] = NBYTE(1, SIZE);
+
+        for (std::size_t ix = 0; ix < COUNT; ++ix) {
+            char* entry_p = image_p + ImageToc::HEADER_SIZE + ix * ImageToc::ENTRY_SIZE;
+
+            entry_p[0] = static_cast<char>(IDS[ix]);
+            entry_p[1] = NBYTE(0, OFFSETS[ix]);
+            entry_p[2] = NBYTE(1, OFFSETS[ix]);
+        }
+    }
+
+    template <std::size_t... Ix>
+    void serialize(char* image_p, std::index_sequence<Ix...>) const {
+        encodeToc(image_p);
+        (encode<Params>(image_p + OFFSETS[Ix], std::get<Ix>(mValues)), ...);
+    }
+
+    /* Records at OFFSETS - skip, skip is TOC_SIZE for legacy images */
+    template <std::size_t... Ix>
+    bool deserialize(const char* image_p, unsigned short skip, std::index_sequence<Ix...>) {
+        return (decode<Params>(image_p + OFFSETS[Ix] - skip, std::get<Ix>(mValues)) & ... & true);
+    }
+
+private:
+    std::tuple<typename Params::Type...> mValues;
+};
+
+} // namespace
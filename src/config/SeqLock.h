@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <stdint.h>
+#include <type_traits>
+
+namespace config {
+
+/* Value of one writer for any number of readers which never block it.
+ *
+ * The sequence is odd while a store is in progress. load() copies the
+ * value and retries if the sequence was odd or has moved meanwhile, so it
+ * returns either the old or the new value, never a mix. The value is kept
+ * in atomic words, a load racing a store is no data race. Loads must not
+ * interrupt the writer (ISR), they would spin forever. */
+template<typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "Not a trivially copyable type");
+
+public:
+    SeqLock() : SeqLock(T()) {}
+    explicit SeqLock(const T& value) : mSequence(0) { store(value); }
+
+    SeqLock(SeqLock const&) = delete;
+    SeqLock& operator= (SeqLock const&) = delete;
+
+    T load() const;
+
+    /* One writer at a time */
+    void store(const T& value);
+
+    /* Stores so far */
+    unsigned long version() const { return mSequence.load(std::memory_order_acquire) >> 1; }
+
+private:
+    using Word = uint32_t;
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(Word) - 1) / sizeof(Word);
+
+    std::atomic<unsigned long> mSequence;
+    std::array<std::atomic<Word>, WORDS> mWords;
+};
+
+template<typename T>
+T SeqLock<T>::load() const {
+
+    Word words[WORDS];
+    unsigned long begin;
+    unsigned long end;
+
+    do {
+        begin = mSequence.load(std::memory_order_acquire);
+
+        for (size_t ix = 0; ix < WORDS; ++ix) {
+            words[ix] = mWords[ix].load(std::memory_order_relaxed);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        end = mSequence.load(std::memory_order_relaxed);
+
+    } while ((begin & 1) || (begin != end));
+
+    T value;
+    std::memcpy(&value, words, sizeof(T));
+
+    return value;
+}
+
+template<typename T>
+void SeqLock<T>::store(const T& value) {
+
+    Word words[WORDS] = {};
+    std::memcpy(words, &value, sizeof(T));
+
+    unsigned long sequence = mSequence.load(std::memory_order_relaxed);
+
+    mSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (size_t ix = 0; ix < WORDS; ++ix) {
+        mWords[ix].store(words[ix], std::memory_order_relaxed);
+    }
+
+    mSequence.store(sequence + 2, std::memory_order_release);
+}
+
+} // namespace
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+#include <console.h>
+
+#include "ShadowByteBuffer.h"
+
+using namespace console;
+using namespace config;
+
+ShadowByteBuffer::ShadowByteBuffer(ByteBuffer& backend, unsigned short pageSize)
+  : mBackend(backend),
+    mPageSize(std::max<unsigned short>(pageSize, 1)),
+    mData(backend.size()),
+    mShadow(backend.size()),
+    mDirtyBegin(backend.size()),
+    mDirtyEnd(0),
+    mStats{}
+{
+    mBackend.readBlock(0, mShadow.data(), mShadow.size());
+    mData = mShadow;
+}
+
+unsigned short ShadowByteBuffer::size()
+{
+    return mData.size();
+}
+
+const char ShadowByteBuffer::read(unsigned short index)
+{
+    return mData[index];
+}
+
+void ShadowByteBuffer::write(unsigned short index, const char value)
+{
+    mData[index] = value;
+    markDirty(index, index + 1);
+}
+
+const char* ShadowByteBuffer::data()
+{
+    return mData.data();
+}
+
+unsigned short ShadowByteBuffer::readBlock(unsigned short index, char* data_p, unsigned short length)
+{
+    memcpy(data_p, mData.data() + index, length);
+    return length;
+}
+
+unsigned short ShadowByteBuffer::writeBlock(unsigned short index, const char* data_p, unsigned short length)
+{
+    memcpy(mData.data() + index, data_p, length);
+    markDirty(index, index + length);
+    return length;
+}
+
+void ShadowByteBuffer::commit()
+{
+    if (mDirtyBegin >= mDirtyEnd) {
+        return;
+    }
+
+    bool dirty = false;
+
+    for (unsigned short number = mDirtyBegin / mPageSize; number <= (mDirtyEnd - 1) / mPageSize; ++number) {
+
+        unsigned short offset = number * mPageSize;
+        unsigned short length = pageLength(number);
+
+        ++mStats.compared;
+
+        if (isEqual(mData.data() + offset, mShadow.data() + offset, length)) {
+            continue;
+        }
+
+        LOG("Shadow flush: page=%u", number);
+
+        mBackend.writeBlock(offset, mData.data() + offset, length);
+        memcpy(mShadow.data() + offset, mData.data() + offset, length);
+
+        ++mStats.flushes;
+        mStats.bytes += length;
+
+        dirty = true;
+    }
+
+    mDirtyBegin = mData.size();
+    mDirtyEnd = 0;
+
+    if (dirty) {
+        mBackend.commit();
+        ++mStats.commits;
+    }
+}
+
+void ShadowByteBuffer::rollback()
+{
+    if (mDirtyBegin < mDirtyEnd) {
+        memcpy(mData.data() + mDirtyBegin, mShadow.data() + mDirtyBegin, mDirtyEnd - mDirtyBegin);
+    }
+
+    mDirtyBegin = mData.size();
+    mDirtyEnd = 0;
+}
+
+const ShadowByteBuffer::Stats& ShadowByteBuffer::stats() const
+{
+    return mStats;
+}
+
+void ShadowByteBuffer::resetStats()
+{
+    mStats = Stats{};
+}
+
+void ShadowByteBuffer::markDirty(unsigned short begin, unsigned short end)
+{
+    mDirtyBegin = std::min(mDirtyBegin, begin);
+    mDirtyEnd = std::max(mDirtyEnd, end);
+}
+
+unsigned short ShadowByteBuffer::pageLength(unsigned short number)
+{
+    unsigned long start = static_cast<unsigned long>(number) * mPageSize;
+
+    return std::min<unsigned long>(mPageSize, mData.size() - start);
+}
+
+bool ShadowByteBuffer::isEqual(const char* a_p, const char* b_p, unsigned short length)
+{
+#if CONFIG_PLATFORM_HOST
+    /* The C library compares with vector instructions */
+    return memcmp(a_p, b_p, length) == 0;
+#else
+    unsigned short ix = 0;
+
+    for (; ix + sizeof(uint32_t) <= length; ix += sizeof(uint32_t)) {
+
+        uint32_t a;
+        uint32_t b;
+
+        memcpy(&a, a_p + ix, sizeof(a));
+        memcpy(&b, b_p + ix, sizeof(b));
+
+        if (a != b) {
+            return false;
+        }
+    }
+
+    for (; ix < length; ++ix) {
+
+        if (a_p[ix] != b_p[ix]) {
+            return false;
+        }
+    }
+
+    return true;
+#endif
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "ByteBuffer.h"
+
+namespace config {
+
+/* Full RAM image of another ByteBuffer with a shadow of what it holds.
+ *
+ * Reads and writes stay in RAM, data() exposes the image. commit()
+ * compares the pages written since the last commit with the shadow, a
+ * word at a time, and writes only the pages which differ to the backend
+ * before committing it. A commit which changed nothing does not reach
+ * the backend at all.
+ *
+ * It costs two copies of the backend in RAM, the image and the shadow.
+ * Meant for backends which write whatever they are given, e.g. flash
+ * sectors (StorageFlashSim) or a mapped file (StorageMmap). StorageEeprom
+ * keeps a RAM image and a dirty range of its own and skips clean commits
+ * already; over it the shadow only adds the two copies, do not stack
+ * them on the device. */
+class ShadowByteBuffer : public ByteBuffer {
+public:
+    struct Stats {
+        unsigned long commits;    /* commits which wrote to the backend */
+        unsigned long compared;   /* pages compared with the shadow */
+        unsigned long flushes;    /* pages written to the backend */
+        unsigned long bytes;      /* bytes written to the backend */
+    };
+
+    /* Reads the whole backend into the image */
+    ShadowByteBuffer(ByteBuffer& backend, unsigned short pageSize = 256);
+    ~ShadowByteBuffer() = default;
+
+    using ByteBuffer::read;
+    using ByteBuffer::write;
+
+    const char read(unsigned short index);
+    void write(unsigned short index, const char value);
+
+    unsigned short readBlock(unsigned short index, char* data_p, unsigned short length);
+    unsigned short writeBlock(unsigned short index, const char* data_p, unsigned short length);
+
+    const char* data();
+
+    void commit();
+    unsigned short size();
+
+    /* Drops the writes since the last commit */
+    void rollback();
+
+    const Stats& stats() const;
+    void resetStats();
+
+private:
+    void markDirty(unsigned short begin, unsigned short end);
+    unsigned short pageLength(unsigned short number);
+
+    static bool isEqual(const char* a_p, const char* b_p, unsigned short length);
+
+private:
+    ByteBuffer& mBackend;
+    unsigned short mPageSize;
+
+    std::vector<char> mData;
+    std::vector<char> mShadow;
+
+    /* Range written since the last commit [mDirtyBegin, mDirtyEnd) */
+    unsigned short mDirtyBegin;
+    unsigned short mDirtyEnd;
+
+    Stats mStats;
+};
+
+} // namespace
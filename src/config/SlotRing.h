@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#pragma once
+
+namespace config {
+
+/* Wear levelling ring of up to 255 slots with a sequence number each.
+ *
+ * A write fills the slot after the current one with the next sequence
+ * (modulo 256). The slots from slot 0 which continue its sequence are the
+ * current round, the last of them is the current slot. If a reset tore
+ * slot 0 at the wrap around, the previous round runs from slot 1. With at
+ * most 255 slots a stale slot never continues the sequence.
+ *
+ * readSlot(slot, sequence&) is false for an erased or invalid slot. Finds
+ * the current slot with O(log size) reads, false if there is none. */
+template <typename ReadSlot>
+bool findCurrentSlot(unsigned char size, ReadSlot readSlot, unsigned char& current) {
+
+    unsigned char base = 0;
+    unsigned char baseSequence;
+
+    if (!readSlot(base, baseSequence)) {
+
+        base = 1;
+
+        if ((size < 2) || !readSlot(base, baseSequence)) {
+            return false;
+        }
+    }
+
+    unsigned char low = base;
+    unsigned short high = size;
+
+    while (high - low > 1) {
+
+        unsigned char middle = low + (high - low) / 2;
+        unsigned char sequence;
+
+        if (readSlot(middle, sequence) &&
+            (sequence == static_cast<unsigned char>(baseSequence + (middle - base)))) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+
+    current = low;
+
+    return true;
+}
+
+} // namespace
@@ -7,6 +7,8 @@
  * (at your option) any later version.
  */
 
+#include <algorithm>
+#include <string.h>
 #include <Arduino.h>
 #include <EEPROM.h>
 #include <console.h>
@@ -17,7 +19,9 @@ using namespace console;
 using namespace config;
 
 StorageEeprom::StorageEeprom(unsigned short size)
-  : mSize(size)
+  : mSize(size),
+    mDirtyBegin(size),
+    mDirtyEnd(0)
 {
     EEPROM.begin(size);
 }
@@ -34,14 +38,75 @@ const char StorageEeprom::read(unsigned short index)
 
 void StorageEeprom::write(unsigned short index, const char value)
 {
-    if (EEPROM.read(index) != value) {
+    if (static_cast<char>(EEPROM.read(index)) != value) {
         EEPROM.write(index, value);
+        markDirty(index, index + 1);
     }
 }
 
+const char* StorageEeprom::data()
+{
+    return reinterpret_cast<const char*>(EEPROM.getConstDataPtr());
+}
+
+unsigned short StorageEeprom::readBlock(unsigned short index, char* data_p, unsigned short length)
+{
+    memcpy(data_p, EEPROM.getConstDataPtr() + index, length);
+    return length;
+}
+
+unsigned short StorageEeprom::writeBlock(unsigned short index, const char* data_p, unsigned short length)
+{
+    const char* current_p = reinterpret_cast<const char*>(EEPROM.getConstDataPtr()) + index;
+
+    // Only the changed span is copied, getDataPtr() marks the EEPROM dirty
+    unsigned short first = std::mismatch(current_p, current_p + length, data_p).first - current_p;
+
+    if (first == length) {
+        return length;
+    }
+
+    unsigned short last = length;
+
+    while (current_p[last - 1] == data_p[last - 1]) {
+        --last;
+    }
+
+    memcpy(EEPROM.getDataPtr() + index + first, data_p + first, last - first);
+    markDirty(index + first, index + last);
+
+    return length;
+}
+
 void StorageEeprom::commit()
 {
+    if (!isDirty()) {
+        LOG("EEPROM commit skipped, no changes");
+        return;
+    }
+
+    LOG("EEPROM commit: %u..%u", mDirtyBegin, mDirtyEnd);
+
     EEPROM.commit();
+
+    mDirtyBegin = mSize;
+    mDirtyEnd = 0;
+}
+
+bool StorageEeprom::isDirty() const
+{
+    return mDirtyBegin < mDirtyEnd;
+}
+
+unsigned short StorageEeprom::dirtySize() const
+{
+    return isDirty() ? (mDirtyEnd - mDirtyBegin) : 0;
+}
+
+void StorageEeprom::markDirty(unsigned short begin, unsigned short end)
+{
+    mDirtyBegin = std::min(mDirtyBegin, begin);
+    mDirtyEnd = std::max(mDirtyEnd, end);
 }
 
 #if LOG_LEVEL >= LOG_LEVEL_DEBUG
@@ -20,16 +20,37 @@ public:
     StorageEeprom(unsigned short size);
     ~StorageEeprom() = default;
 
+    using ByteBuffer::read;
+    using ByteBuffer::write;
+
     const char read(unsigned short index);
     void write(unsigned short index, const char value);
 
+    unsigned short readBlock(unsigned short index, char* data_p, unsigned short length);
+    unsigned short writeBlock(unsigned short index, const char* data_p, unsigned short length);
+
+    const char* data();
+
+    /* Commits only if a write changed the image since the last commit */
     void commit();
     unsigned short size();
 
+    bool isDirty() const;
+
+    /* Bytes in the range changed since the last commit */
+    unsigned short dirtySize() const;
+
     void dump(unsigned int limit);
 
+private:
+    void markDirty(unsigned short begin, unsigned short end);
+
 private:
     unsigned short mSize;
+
+    /* Changed range [mDirtyBegin, mDirtyEnd), empty when clean */
+    unsigned short mDirtyBegin;
+    unsigned short mDirtyEnd;
 };
 
 } // namespace
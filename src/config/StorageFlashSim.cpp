@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <algorithm>
+#include <string.h>
+#include <console.h>
+
+#include "StorageFlashSim.h"
+
+using namespace console;
+using namespace config;
+
+StorageFlashSim::StorageFlashSim(unsigned short size, unsigned short sectorSize, unsigned short pageSize)
+  : mSectorSize(sectorSize),
+    mPageSize(pageSize),
+    mEraseMicros(45000),
+    mProgramMicros(700),
+    mIsAlwaysErase(false),
+    mData(size, ERASED),
+    mFlash(size, ERASED),
+    mDirtyPages(),
+    mErases(),
+    mCommits(0),
+    mWritten(0),
+    mPrograms(0),
+    mProgrammed(0)
+{
+    if (!mPageSize || !mSectorSize || (mSectorSize % mPageSize)) {
+        LOG("Flash sector %u is no multiple of page %u, pages are sectors", mSectorSize, mPageSize);
+        mSectorSize = std::max<unsigned short>(mSectorSize, 1);
+        mPageSize = mSectorSize;
+    }
+
+    mDirtyPages.resize((size + mPageSize - 1) / mPageSize, false);
+    mErases.resize((size + mSectorSize - 1) / mSectorSize, 0);
+}
+
+unsigned short StorageFlashSim::size()
+{
+    return mData.size();
+}
+
+const char StorageFlashSim::read(unsigned short index)
+{
+    return mData[index];
+}
+
+void StorageFlashSim::write(unsigned short index, const char value)
+{
+    mData[index] = value;
+    markPages(index, index + 1);
+}
+
+const char* StorageFlashSim::data()
+{
+    return mData.data();
+}
+
+unsigned short StorageFlashSim::readBlock(unsigned short index, char* data_p, unsigned short length)
+{
+    memcpy(data_p, mData.data() + index, length);
+    return length;
+}
+
+unsigned short StorageFlashSim::writeBlock(unsigned short index, const char* data_p, unsigned short length)
+{
+    memcpy(mData.data() + index, data_p, length);
+    markPages(index, index + length);
+    return length;
+}
+
+void StorageFlashSim::markPages(unsigned short begin, unsigned short end)
+{
+    if (begin >= end) {
+        return;
+    }
+
+    mWritten += end - begin;
+
+    for (unsigned short page = begin / mPageSize; page <= (end - 1) / mPageSize; ++page) {
+        mDirtyPages[page] = true;
+    }
+}
+
+void StorageFlashSim::commit()
+{
+    ++mCommits;
+
+    for (unsigned short sector = 0; sector < mErases.size(); ++sector) {
+        commitSector(sector);
+    }
+}
+
+void StorageFlashSim::commitSector(unsigned short sector)
+{
+    unsigned short pagesPerSector = mSectorSize / mPageSize;
+    unsigned short first = sector * pagesPerSector;
+    unsigned short last = std::min<unsigned short>(first + pagesPerSector, mDirtyPages.size());
+
+    bool isDirty = false;
+    bool isEraseNeeded = mIsAlwaysErase;
+
+    for (unsigned short page = first; page < last; ++page) {
+
+        if (!mDirtyPages[page]) {
+            continue;
+        }
+
+        isDirty = true;
+
+        unsigned short begin = page * mPageSize;
+        unsigned short end = std::min<unsigned short>(begin + mPageSize, mData.size());
+
+        /* Programming only clears bits */
+        for (unsigned short ix = begin; (ix < end) && !isEraseNeeded; ++ix) {
+            isEraseNeeded = (mData[ix] & ~mFlash[ix]) != 0;
+        }
+    }
+
+    if (!isDirty) {
+        return;
+    }
+
+    if (isEraseNeeded) {
+
+        unsigned short begin = first * mPageSize;
+        unsigned short end = std::min<unsigned short>(last * mPageSize, mFlash.size());
+
+        std::fill(mFlash.begin() + begin, mFlash.begin() + end, ERASED);
+        ++mErases[sector];
+    }
+
+    for (unsigned short page = first; page < last; ++page) {
+
+        unsigned short begin = page * mPageSize;
+        unsigned short end = std::min<unsigned short>(begin + mPageSize, mData.size());
+
+        bool isErased = std::all_of(mData.begin() + begin, mData.begin() + end,
+                                    [](char value) { return value == ERASED; });
+
+        /* After an erase every page with data is programmed again */
+        if ((isEraseNeeded && !isErased) || (!isEraseNeeded && mDirtyPages[page])) {
+            program(page);
+        }
+
+        mDirtyPages[page] = false;
+    }
+}
+
+void StorageFlashSim::program(unsigned short page)
+{
+    unsigned short begin = page * mPageSize;
+    unsigned short end = std::min<unsigned short>(begin + mPageSize, mData.size());
+
+    for (unsigned short ix = begin; ix < end; ++ix) {
+        mFlash[ix] &= mData[ix];
+    }
+
+    ++mPrograms;
+    mProgrammed += end - begin;
+}
+
+void StorageFlashSim::setAlwaysErase(bool isAlwaysErase)
+{
+    mIsAlwaysErase = isAlwaysErase;
+}
+
+void StorageFlashSim::setTiming(unsigned long eraseMicros, unsigned long programMicros)
+{
+    mEraseMicros = eraseMicros;
+    mProgramMicros = programMicros;
+}
+
+unsigned short StorageFlashSim::sectors() const
+{
+    return mErases.size();
+}
+
+unsigned long StorageFlashSim::erases(unsigned short sector) const
+{
+    return (sector < mErases.size()) ? mErases[sector] : 0;
+}
+
+unsigned long StorageFlashSim::maxErases() const
+{
+    return mErases.empty() ? 0 : *std::max_element(mErases.begin(), mErases.end());
+}
+
+unsigned long StorageFlashSim::totalErases() const
+{
+    unsigned long total = 0;
+
+    for (auto erases: mErases) {
+        total += erases;
+    }
+
+    return total;
+}
+
+unsigned long StorageFlashSim::commits() const
+{
+    return mCommits;
+}
+
+unsigned long StorageFlashSim::writtenBytes() const
+{
+    return mWritten;
+}
+
+unsigned long StorageFlashSim::programmedBytes() const
+{
+    return mProgrammed;
+}
+
+double StorageFlashSim::writeAmplification() const
+{
+    return mWritten ? static_cast<double>(mProgrammed) / mWritten : 0;
+}
+
+unsigned long long StorageFlashSim::busyMicros() const
+{
+    return static_cast<unsigned long long>(totalErases()) * mEraseMicros +
+           static_cast<unsigned long long>(mPrograms) * mProgramMicros;
+}
+
+unsigned long long StorageFlashSim::lifetimeCommits(unsigned long endurance) const
+{
+    unsigned long worst = maxErases();
+
+    return worst ? static_cast<unsigned long long>(mCommits) * endurance / worst : 0;
+}
+
+void StorageFlashSim::resetStats()
+{
+    std::fill(mErases.begin(), mErases.end(), 0);
+
+    mCommits = 0;
+    mWritten = 0;
+    mPrograms = 0;
+    mProgrammed = 0;
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "ByteBuffer.h"
+
+namespace config {
+
+/* NOR flash behind a RAM image, for measuring what commits cost.
+ *
+ * Writes go to the RAM image and mark their pages. commit() programs the
+ * marked pages of a sector if programming alone gets there (bits only go
+ * from 1 to 0); otherwise it erases the sector and programs all its
+ * pages that are not erased. setAlwaysErase() models the ESP8266 EEPROM
+ * emulation instead: every sector with a marked page is erased and
+ * programmed whole. Erases and page programs are counted per sector and
+ * timed with setTiming(); nothing sleeps. */
+class StorageFlashSim : public ByteBuffer {
+public:
+    StorageFlashSim(unsigned short size, unsigned short sectorSize = 4096, unsigned short pageSize = 256);
+    ~StorageFlashSim() = default;
+
+    using ByteBuffer::read;
+    using ByteBuffer::write;
+
+    const char read(unsigned short index);
+    void write(unsigned short index, const char value);
+
+    unsigned short readBlock(unsigned short index, char* data_p, unsigned short length);
+    unsigned short writeBlock(unsigned short index, const char* data_p, unsigned short length);
+
+    const char* data();
+
+    void commit();
+    unsigned short size();
+
+    void setAlwaysErase(bool isAlwaysErase);
+
+    /* Sector erase and page program latencies, 45 ms and 700 us by
+     * default as for common SPI NOR parts */
+    void setTiming(unsigned long eraseMicros, unsigned long programMicros);
+
+    unsigned short sectors() const;
+    unsigned long erases(unsigned short sector) const;
+    unsigned long maxErases() const;
+    unsigned long totalErases() const;
+
+    unsigned long commits() const;
+
+    /* Bytes given to write calls, bytes programmed into the flash */
+    unsigned long writtenBytes() const;
+    unsigned long programmedBytes() const;
+
+    /* programmed / written, 0 before the first write */
+    double writeAmplification() const;
+
+    /* Modelled time spent erasing and programming */
+    unsigned long long busyMicros() const;
+
+    /* Commits until the most worn sector reaches endurance erases, at the
+     * rate seen so far; 0 if no sector was erased yet */
+    unsigned long long lifetimeCommits(unsigned long endurance = 100000) const;
+
+    /* Clears the counters, keeps the contents */
+    void resetStats();
+
+private:
+    static constexpr char ERASED = static_cast<char>(0xFF);
+
+    void markPages(unsigned short begin, unsigned short end);
+    void commitSector(unsigned short sector);
+    void program(unsigned short page);
+
+private:
+    unsigned short mSectorSize;
+    unsigned short mPageSize;
+    unsigned long mEraseMicros;
+    unsigned long mProgramMicros;
+    bool mIsAlwaysErase;
+
+    std::vector<char> mData;    /* image written */
+    std::vector<char> mFlash;   /* image committed */
+    std::vector<bool> mDirtyPages;
+    std::vector<unsigned long> mErases;
+
+    unsigned long mCommits;
+    unsigned long mWritten;
+    unsigned long mPrograms;    /* pages */
+    unsigned long mProgrammed;  /* bytes */
+};
+
+} // namespace
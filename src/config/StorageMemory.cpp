@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <string.h>
+
+#include "StorageMemory.h"
+
+using namespace config;
+
+StorageMemory::StorageMemory(unsigned short size, char fill)
+  : mData(size, fill),
+    mCommits(0)
+{}
+
+unsigned short StorageMemory::size()
+{
+    return mData.size();
+}
+
+const char StorageMemory::read(unsigned short index)
+{
+    return mData[index];
+}
+
+void StorageMemory::write(unsigned short index, const char value)
+{
+    mData[index] = value;
+}
+
+const char* StorageMemory::data()
+{
+    return mData.data();
+}
+
+unsigned short StorageMemory::readBlock(unsigned short index, char* data_p, unsigned short length)
+{
+    memcpy(data_p, mData.data() + index, length);
+    return length;
+}
+
+unsigned short StorageMemory::writeBlock(unsigned short index, const char* data_p, unsigned short length)
+{
+    memcpy(mData.data() + index, data_p, length);
+    return length;
+}
+
+void StorageMemory::commit()
+{
+    ++mCommits;
+}
+
+unsigned long StorageMemory::commits() const
+{
+    return mCommits;
+}
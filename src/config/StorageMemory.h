@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "ByteBuffer.h"
+
+namespace config {
+
+class StorageMemory : public ByteBuffer {
+public:
+    StorageMemory(unsigned short size, char fill = static_cast<char>(0xFF));
+    ~StorageMemory() = default;
+
+    using ByteBuffer::read;
+    using ByteBuffer::write;
+
+    const char read(unsigned short index);
+    void write(unsigned short index, const char value);
+
+    unsigned short readBlock(unsigned short index, char* data_p, unsigned short length);
+    unsigned short writeBlock(unsigned short index, const char* data_p, unsigned short length);
+
+    const char* data();
+
+    void commit();
+    unsigned short size();
+
+    unsigned long commits() const;
+
+private:
+    std::vector<char> mData;
+    unsigned long mCommits;
+};
+
+} // namespace
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <console.h>
+
+#include "StorageMmap.h"
+
+using namespace console;
+using namespace config;
+
+StorageMmap::StorageMmap(const char* path, unsigned short size, char fill)
+  : mFile(-1),
+    mData_p(nullptr),
+    mSize(0),
+    mDirtyBegin(0),
+    mDirtyEnd(0),
+    mCommits(0)
+{
+    mFile = ::open(path, O_RDWR | O_CREAT, 0644);
+
+    if (mFile < 0) {
+        LOG("Cannot open %s: %s", path, strerror(errno));
+        return;
+    }
+
+    struct stat status;
+
+    if (fstat(mFile, &status) != 0) {
+        LOG("Cannot stat %s: %s", path, strerror(errno));
+        close();
+        return;
+    }
+
+    off_t length = status.st_size;
+
+    if ((length < size) && (ftruncate(mFile, size) != 0)) {
+        LOG("Cannot extend %s: %s", path, strerror(errno));
+        close();
+        return;
+    }
+
+    void* mapping_p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, mFile, 0);
+
+    if (mapping_p == MAP_FAILED) {
+        LOG("Cannot map %s: %s", path, strerror(errno));
+        close();
+        return;
+    }
+
+    mData_p = static_cast<char*>(mapping_p);
+    mSize = size;
+    mDirtyBegin = size;
+
+    if (length < size) {
+        memset(mData_p + length, fill, size - length);
+        markDirty(length, size);
+    }
+}
+
+StorageMmap::~StorageMmap()
+{
+    close();
+}
+
+void StorageMmap::close()
+{
+    if (mData_p) {
+        munmap(mData_p, mSize);
+        mData_p = nullptr;
+    }
+
+    if (mFile >= 0) {
+        ::close(mFile);
+        mFile = -1;
+    }
+
+    mSize = 0;
+    mDirtyBegin = 0;
+    mDirtyEnd = 0;
+}
+
+bool StorageMmap::isOpen() const
+{
+    return mData_p != nullptr;
+}
+
+unsigned short StorageMmap::size()
+{
+    return mSize;
+}
+
+const char StorageMmap::read(unsigned short index)
+{
+    return mData_p[index];
+}
+
+void StorageMmap::write(unsigned short index, const char value)
+{
+    if (mData_p[index] != value) {
+        mData_p[index] = value;
+        markDirty(index, index + 1);
+    }
+}
+
+const char* StorageMmap::data()
+{
+    return mData_p;
+}
+
+unsigned short StorageMmap::readBlock(unsigned short index, char* data_p, unsigned short length)
+{
+    memcpy(data_p, mData_p + index, length);
+    return length;
+}
+
+unsigned short StorageMmap::writeBlock(unsigned short index, const char* data_p, unsigned short length)
+{
+    char* current_p = mData_p + index;
+
+    // Only the changed span is stored, unchanged pages stay clean
+    unsigned short first = std::mismatch(current_p, current_p + length, data_p).first - current_p;
+
+    if (first == length) {
+        return length;
+    }
+
+    unsigned short last = length;
+
+    while (current_p[last - 1] == data_p[last - 1]) {
+        --last;
+    }
+
+    memcpy(current_p + first, data_p + first, last - first);
+    markDirty(index + first, index + last);
+
+    return length;
+}
+
+void StorageMmap::commit()
+{
+    if (!isDirty()) {
+        LOG("Mmap commit skipped, no changes");
+        return;
+    }
+
+    /* msync takes a page aligned address */
+    static const long sPageSize = sysconf(_SC_PAGESIZE);
+
+    unsigned long begin = mDirtyBegin - (mDirtyBegin % sPageSize);
+
+    LOG("Mmap commit: %u..%u", mDirtyBegin, mDirtyEnd);
+
+    if (msync(mData_p + begin, mDirtyEnd - begin, MS_SYNC) != 0) {
+        LOG("Mmap commit failed: %s", strerror(errno));
+        return;
+    }
+
+    ++mCommits;
+
+    mDirtyBegin = mSize;
+    mDirtyEnd = 0;
+}
+
+bool StorageMmap::isDirty() const
+{
+    return mDirtyBegin < mDirtyEnd;
+}
+
+unsigned short StorageMmap::dirtySize() const
+{
+    return isDirty() ? (mDirtyEnd - mDirtyBegin) : 0;
+}
+
+unsigned long StorageMmap::commits() const
+{
+    return mCommits;
+}
+
+void StorageMmap::markDirty(unsigned short begin, unsigned short end)
+{
+    mDirtyBegin = std::min(mDirtyBegin, begin);
+    mDirtyEnd = std::max(mDirtyEnd, end);
+}
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#pragma once
+
+#if defined(__linux__)
+
+#include "ByteBuffer.h"
+
+namespace config {
+
+/* Image in a memory mapped file, Linux only.
+ *
+ * Reads and writes are loads and stores on a shared mapping, data()
+ * exposes it to the iterators. commit() msyncs the pages of the range
+ * changed since the last commit only. Writes which are not committed
+ * still reach the file through the page cache, unless the system goes
+ * down first. */
+class StorageMmap : public ByteBuffer {
+public:
+    /* Creates the file or extends it to size, new bytes are fill */
+    StorageMmap(const char* path, unsigned short size, char fill = static_cast<char>(0xFF));
+    ~StorageMmap();
+
+    StorageMmap(StorageMmap const&) = delete;
+    StorageMmap& operator= (StorageMmap const&) = delete;
+
+    using ByteBuffer::read;
+    using ByteBuffer::write;
+
+    const char read(unsigned short index);
+    void write(unsigned short index, const char value);
+
+    unsigned short readBlock(unsigned short index, char* data_p, unsigned short length);
+    unsigned short writeBlock(unsigned short index, const char* data_p, unsigned short length);
+
+    const char* data();
+
+    /* Commits only if a write changed the image since the last commit */
+    void commit();
+
+    /* 0 if the file could not be mapped */
+    unsigned short size();
+
+    bool isOpen() const;
+    bool isDirty() const;
+
+    /* Bytes in the range changed since the last commit */
+    unsigned short dirtySize() const;
+
+    unsigned long commits() const;
+
+private:
+    void markDirty(unsigned short begin, unsigned short end);
+    void close();
+
+private:
+    int mFile;
+    char* mData_p;
+    unsigned short mSize;
+
+    /* Changed range [mDirtyBegin, mDirtyEnd), empty when clean */
+    unsigned short mDirtyBegin;
+    unsigned short mDirtyEnd;
+
+    unsigned long mCommits;
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#include <algorithm>
+#include <string.h>
+
+#include "PowerLossStorage.h"
+
+using namespace tests;
+
+// Class PowerLossStorage
+
+PowerLossStorage::PowerLossStorage(unsigned short size)
+    : mData(size, static_cast<char>(0xFF)),
+      mWritten(0),
+      mLimit(NO_LIMIT),
+      mIsCut(false)
+{
+}
+
+const char PowerLossStorage::read(unsigned short index)
+{
+    return (index < mData.size()) ? mData[index] : 0;
+}
+
+void PowerLossStorage::write(unsigned short index, const char value)
+{
+    if ((index < mData.size()) && budget(1)) {
+        mData[index] = value;
+    }
+}
+
+unsigned short PowerLossStorage::readBlock(unsigned short index, char* data_p, unsigned short length)
+{
+    if (index >= mData.size()) {
+        return 0;
+    }
+
+    unsigned short count = std::min<unsigned short>(length, mData.size() - index);
+
+    memcpy(data_p, mData.data() + index, count);
+
+    return count;
+}
+
+unsigned short PowerLossStorage::writeBlock(unsigned short index, const char* data_p, unsigned short length)
+{
+    if (index >= mData.size()) {
+        return 0;
+    }
+
+    unsigned short count = std::min<unsigned short>(length, mData.size() - index);
+
+    memcpy(mData.data() + index, data_p, budget(count));
+
+    return count;
+}
+
+const char* PowerLossStorage::data()
+{
+    return mData.data();
+}
+
+void PowerLossStorage::commit()
+{
+}
+
+unsigned short PowerLossStorage::size()
+{
+    return mData.size();
+}
+
+void PowerLossStorage::cutAfter(unsigned long bytes)
+{
+    mLimit = mWritten + bytes;
+    mIsCut = false;
+}
+
+void PowerLossStorage::restore()
+{
+    mLimit = NO_LIMIT;
+    mIsCut = false;
+}
+
+unsigned long PowerLossStorage::written() const
+{
+    return mWritten;
+}
+
+bool PowerLossStorage::isCut() const
+{
+    return mIsCut;
+}
+
+unsigned short PowerLossStorage::budget(unsigned short length)
+{
+    unsigned long left = (mLimit == NO_LIMIT) ? length : mLimit - mWritten;
+    unsigned short count = std::min<unsigned long>(length, left);
+
+    mWritten += count;
+    mIsCut = mIsCut || (count < length);
+
+    return count;
+}
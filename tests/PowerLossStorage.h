@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <config/ByteBuffer.h>
+
+namespace tests {
+
+/* Storage which loses power after a number of written bytes.
+ *
+ * Writes persist at once, as on a byte programmed EEPROM or FRAM. After
+ * cutAfter(bytes) only that many more bytes are written: the block write
+ * at the limit is torn, everything later is lost. restore() brings the
+ * power back with what persisted, as a reset does. */
+class PowerLossStorage : public config::ByteBuffer {
+public:
+    PowerLossStorage(unsigned short size);
+    ~PowerLossStorage() = default;
+
+    using ByteBuffer::read;
+    using ByteBuffer::write;
+
+    const char read(unsigned short index);
+    void write(unsigned short index, const char value);
+
+    unsigned short readBlock(unsigned short index, char* data_p, unsigned short length);
+    unsigned short writeBlock(unsigned short index, const char* data_p, unsigned short length);
+
+    const char* data();
+
+    void commit();
+    unsigned short size();
+
+    void cutAfter(unsigned long bytes);
+    void restore();
+
+    /* Bytes persisted so far */
+    unsigned long written() const;
+
+    /* A write was lost since the power was cut */
+    bool isCut() const;
+
+private:
+    static constexpr unsigned long NO_LIMIT = static_cast<unsigned long>(-1);
+
+    /* Bytes of length which still persist */
+    unsigned short budget(unsigned short length);
+
+private:
+    std::vector<char> mData;
+    unsigned long mWritten;
+    unsigned long mLimit;
+    bool mIsCut;
+};
+
+} // namespace
@@ -0,0 +1,547 @@
+/*
+ * Copyright (C) 2026 Dmitry Korobkov <dmitry.korobkov.nn@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ */
+
+/*
+ * Host tests of the storage engines.
+ *
+ *   config_tests [<filter substring>]
+ *
+ * The power-loss cases run a sequence of committed updates once for every
+ * byte at which the power can fail (see PowerLossStorage), reset and check
+ * the value read back: the last committed one, or the one being written
+ * when the power failed. Fails if any check does.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <checksum.h>
+#include <config.h>
+#include <config/Crc.h>
+
+#include "PowerLossStorage.h"
+
+using namespace config;
+using namespace tests;
+
+namespace {
+
+unsigned int sFailures = 0;
+
+bool expect(bool condition, const std::string& what)
+{
+    if (!condition) {
+        std::printf("  FAIL: %s\n", what.c_str());
+        ++sFailures;
+    }
+
+    return condition;
+}
+
+bool expect(bool condition, const std::string& what, unsigned long cut)
+{
+    return expect(condition, what + ", power cut after " + std::to_string(cut) + " bytes");
+}
+
+/* Runs setup(), then update(step) for steps 1..steps with the power
+ * failing cut bytes into the updates, for every cut up to the bytes of the
+ * whole sequence. check() gets the last step which completed and whether
+ * the power failed during the next one. */
+void forEachCut(PowerLossStorage& storage, unsigned int steps,
+                const std::function<void()>& setup,
+                const std::function<void(unsigned int step)>& update,
+                const std::function<void(unsigned long cut, unsigned int committed, bool isCut)>& check)
+{
+    storage.restore();
+    setup();
+
+    unsigned long begin = storage.written();
+
+    for (unsigned int step = 1; step <= steps; ++step) {
+        update(step);
+    }
+
+    unsigned long total = storage.written() - begin;
+
+    for (unsigned long cut = 0; cut <= total; ++cut) {
+
+        storage.restore();
+        setup();
+        storage.cutAfter(cut);
+
+        unsigned int committed = 0;
+
+        for (unsigned int step = 1; step <= steps; ++step) {
+
+            update(step);
+
+            if (storage.isCut()) {
+                break;
+            }
+
+            committed = step;
+        }
+
+        bool isCut = storage.isCut();
+
+        storage.restore();
+        check(cut, committed, isCut);
+    }
+}
+
+void erase(PowerLossStorage& storage)
+{
+    for (unsigned short ix = 0; ix < storage.size(); ++ix) {
+        storage.write(ix, static_cast<char>(0xFF));
+    }
+}
+
+// RecordLog: appends and compactions
+
+void testRecordLog()
+{
+    static constexpr unsigned short REGION = 128;
+
+    PowerLossStorage storage(REGION);
+
+    auto setup = [&storage]() {
+
+        erase(storage);
+
+        RecordLog log(storage);
+        log.mount();
+
+        ConfigParameter<std::string> name(5, "name");
+        ConfigParameter<int> value(3, 0);
+
+        log.append(name);
+        log.append(value);
+        log.commit();
+    };
+
+    auto update = [&storage](unsigned int step) {
+
+        RecordLog log(storage);
+        log.mount();
+
+        ConfigParameter<int> value(3, step);
+
+        log.append(value);
+        log.commit();
+    };
+
+    auto check = [&storage](unsigned long cut, unsigned int committed, bool isCut) {
+
+        RecordLog log(storage);
+
+        if (!expect(log.mount(), "log mount", cut)) {
+            return;
+        }
+
+        ConfigParameter<std::string> name(5);
+        ConfigParameter<int> value(3, -1);
+
+        expect(log.load(name) && (name.view() == "name"), "other record kept", cut);
+
+        bool isLoaded = log.load(value);
+        unsigned int read = value.view();
+
+        expect(isLoaded && ((read == committed) || (isCut && (read == committed + 1))),
+               "value " + std::to_string(read) + " after step " + std::to_string(committed), cut);
+    };
+
+    /* Enough steps for several compactions of the 64 byte banks */
+    forEachCut(storage, 16, setup, update, check);
+}
+
+// RecordLog: a bank of live records only is full, compacting it would
+// not make room; an unchanged value needs no room
+
+void testRecordLogFull()
+{
+    StorageMemory storage(128);
+    RecordLog log(storage);
+
+    log.mount();
+
+    bool isAppended = true;
+
+    for (unsigned char id = 0; isAppended; ++id) {
+
+        ConfigParameter<int> value(id, id);
+        isAppended = log.append(value);
+    }
+
+    expect(log.stats().compactions == 0, "no compaction of live records");
+
+    /* Still fine for a value which is in the log already */
+    ConfigParameter<int> same(0, 0);
+
+    expect(log.append(same) && (log.stats().unchanged == 1), "unchanged value in a full log");
+}
+
+// PersistCounter: slot ring wrapping several times, alone and as the
+// record of a ConfigParameter, whose checksum follows the slot
+
+template <typename Counter>
+void testCounter(const std::function<Counter()>& make,
+                 const std::function<PersistCounter&(Counter&)>& value)
+{
+    PowerLossStorage storage(64);
+    Counter counter = make();
+
+    auto setup = [&]() {
+
+        erase(storage);
+        counter = make();
+
+        auto it = storage.begin();
+        counter.write(it);
+    };
+
+    auto update = [&](unsigned int) {
+
+        ++value(counter);
+
+        auto it = storage.begin();
+        counter.write(it);
+        storage.commit();
+    };
+
+    auto check = [&](unsigned long cut, unsigned int committed, bool isCut) {
+
+        Counter restored = make();
+
+        auto it = storage.begin();
+
+        if (!expect(restored.read(it) != it, "counter read", cut)) {
+            return;
+        }
+
+        unsigned int read = value(restored).get();
+
+        expect((read == committed) || (isCut && (read == committed + 1)),
+               "value " + std::to_string(read) + " after step " + std::to_string(committed), cut);
+    };
+
+    /* 4 slots */
+    forEachCut(storage, 13, setup, update, check);
+}
+
+void testCounterRing()
+{
+    testCounter<PersistCounter>(
+        []() { return PersistCounter(4); },
+        [](PersistCounter& counter) -> PersistCounter& { return counter; });
+}
+
+void testCounterRecord()
+{
+    testCounter<ConfigParameter<PersistCounter>>(
+        []() { return ConfigParameter<PersistCounter>(3, PersistCounter(4)); },
+        [](ConfigParameter<PersistCounter>& counter) -> PersistCounter& { return counter.get(); });
+}
+
+// DualSlotByteBuffer: image updates, mount with and without the image CRC
+
+void testDualSlot(bool verify)
+{
+    static constexpr unsigned short IMAGE = 24;
+
+    PowerLossStorage storage(2 * (11 + IMAGE));
+
+    auto fill = [](DualSlotByteBuffer& image, unsigned int value) {
+
+        char bytes[IMAGE];
+
+        for (unsigned short ix = 0; ix < IMAGE; ++ix) {
+            bytes[ix] = static_cast<char>(value + ix);
+        }
+
+        image.write(image.begin(), bytes, IMAGE);
+        image.commit();
+    };
+
+    auto setup = [&]() {
+
+        erase(storage);
+
+        DualSlotByteBuffer image(storage);
+        image.mount();
+        fill(image, 0);
+    };
+
+    auto update = [&](unsigned int step) {
+
+        DualSlotByteBuffer image(storage);
+        image.mount();
+        fill(image, step);
+    };
+
+    auto check = [&](unsigned long cut, unsigned int committed, bool isCut) {
+
+        DualSlotByteBuffer image(storage);
+
+        if (!expect(image.mount(verify), "slot mount", cut)) {
+            return;
+        }
+
+        char bytes[IMAGE];
+        image.read(image.begin(), bytes, IMAGE);
+
+        unsigned int read = static_cast<unsigned char>(bytes[0]);
+        bool isWhole = true;
+
+        for (unsigned short ix = 0; ix < IMAGE; ++ix) {
+            isWhole = isWhole && (static_cast<unsigned char>(bytes[ix]) == static_cast<unsigned char>(read + ix));
+        }
+
+        expect(isWhole, "whole image of " + std::to_string(read), cut);
+        expect((read == committed) || (isCut && (read == committed + 1)),
+               "image " + std::to_string(read) + " after step " + std::to_string(committed), cut);
+    };
+
+    forEachCut(storage, 5, setup, update, check);
+}
+
+// CRC check values: CRC-8/SMBUS as checksum::Checksum(CRC8) computes it,
+// CRC-32 across the slicing-by-8 blocks and the byte tail
+
+void testCrc()
+{
+    const char check[] = "123456789";
+
+    expect(crc8(check, 9) == 0xF4, "CRC-8 check value");
+    expect(crc8(check + 4, 5, crc8(check, 4)) == 0xF4, "CRC-8 continued");
+    expect(crc32(check, 9) == 0xCBF43926, "CRC-32 check value");
+    expect(crc32(check + 3, 6, crc32(check, 3)) == 0xCBF43926, "CRC-32 continued");
+
+    std::vector<char> bytes(300);
+
+    for (unsigned short ix = 0; ix < bytes.size(); ++ix) {
+        bytes[ix] = static_cast<char>(ix * 7 + 3);
+    }
+
+    checksum::Checksum reference(checksum::Checksum::CRC8);
+
+    expect(crc8(bytes.data(), bytes.size()) == reference.calculate(bytes.data(), bytes.size()),
+           "CRC-8 of the checksum library");
+}
+
+// Config image CRC: the records are not checked while it matches
+
+void testImageCrc()
+{
+    auto& config = Config::getInstance();
+
+    config.add<int>(201, 1234);
+    config.add<std::string>(202, "crc");
+    config.setImageCrc(true);
+
+    StorageMemory image(256);
+    config.writeAll(image);
+
+    ImageToc toc(image);
+    ImageToc::Entry number;
+
+    expect(toc.hasCrc() && toc.isIntact(), "image CRC written");
+    expect(toc.find(201, number), "record in the table");
+
+    for (auto decode: { Config::Decode::EAGER, Config::Decode::LAZY }) {
+
+        config.set<int>(201, 0);
+        config.set<std::string>(202, "");
+        config.read(image, decode);
+
+        expect((config.view<int>(201) == 1234) && (config.view<std::string>(202) == "crc"),
+               "intact image read");
+    }
+
+    /* A record changed behind the image CRC: each record is checked */
+    unsigned short payload = number.offset + ConfigParameterBase::HEADER_SIZE;
+
+    image.write(payload, static_cast<char>(image.read(payload) ^ 0x01));
+
+    config.set<int>(201, -1);
+    config.read(image);
+
+    expect(!ImageToc(image).isIntact(), "image CRC mismatch");
+    expect(config.view<int>(201) == -1, "bad record rejected");
+    expect(config.view<std::string>(202) == "crc", "good record read");
+
+    /* The image CRC covers it again: the record checksum is skipped */
+    ImageToc::writeCrc(image, toc.end());
+
+    config.read(image);
+
+    expect(config.view<int>(201) == (1234 ^ 0x01), "record of an intact image not checked");
+
+    config.setImageCrc(false);
+}
+
+// Config in-place writes: only the dirty record changes, unless the
+// buffer no longer holds the image they were placed in
+
+/* Points the table entry of id one byte past its record */
+void moveEntry(ByteBuffer& image, unsigned char id)
+{
+    ImageToc toc(image);
+    ImageToc::Entry entry;
+
+    for (unsigned char ix = 0; toc.entry(ix, entry); ++ix) {
+        if (entry.id == id) {
+            ImageToc::writeEntry(image, ix, id, entry.offset + 1);
+        }
+    }
+}
+
+void testWriteDirty()
+{
+    auto& config = Config::getInstance();
+
+    config.add<int>(210, 1);
+    config.add<std::string>(211, "dirty");
+
+    StorageMemory image(256);
+    config.writeAll(image);
+
+    ImageToc::Entry number;
+    expect(ImageToc(image).find(210, number), "record in the table");
+
+    std::vector<char> before(image.data(), image.data() + image.size());
+
+    config.set<int>(210, 2);
+    config.write(image);
+
+    bool isInPlace = true;
+
+    for (unsigned short ix = 0; ix < image.size(); ++ix) {
+
+        bool isRecord = (ix >= number.offset) && (ix < number.offset + number.length);
+        isInPlace = isInPlace && (isRecord || (image.data()[ix] == before[ix]));
+    }
+
+    expect(isInPlace, "only the dirty record written");
+
+    /* A valid table which places the record elsewhere is stale as well */
+    ImageToc::Entry entry;
+
+    moveEntry(image, 210);
+    config.set<int>(210, 4);
+    config.write(image);
+
+    expect(ImageToc(image).find(210, entry) && (entry.offset == number.offset), "stale entry rewritten");
+
+    /* Another writer erased the image: the next write lays it out again */
+    for (unsigned short ix = 0; ix < image.size(); ++ix) {
+        image.write(ix, static_cast<char>(0xFF));
+    }
+
+    config.set<int>(210, 3);
+    config.write(image);
+
+    expect(ImageToc(image).isValid(), "stale image rewritten");
+
+    config.set<int>(210, 0);
+    config.set<std::string>(211, "");
+    config.read(image);
+
+    expect((config.view<int>(210) == 3) && (config.view<std::string>(211) == "dirty"),
+           "rewritten image read");
+
+    /* Buffers without data() are compared a block of entries at a time */
+    for (unsigned char id = 230; id < 250; ++id) {
+        config.add<int>(id, id);
+    }
+
+    StorageMemory backend(512);
+    CachedByteBuffer cached(backend);
+
+    config.writeAll(cached);
+
+    ImageToc::Entry last;
+    expect(ImageToc(cached).find(249, last), "record past the first block");
+
+    moveEntry(cached, 249);
+    config.set<int>(249, 0);
+    config.write(cached);
+
+    expect(ImageToc(cached).find(249, entry) && (entry.offset == last.offset), "stale entry of a cached image");
+}
+
+// CommitScheduler: the listener set before it still hears the changes
+// and is put back when the scheduler goes
+
+void testSchedulerListener()
+{
+    auto& config = Config::getInstance();
+    StorageMemory image(256);
+
+    unsigned int heard = 0;
+
+    config.add<int>(220, 0);
+    config.onChange([&heard](uint8_t) { ++heard; });
+
+    {
+        CommitScheduler scheduler(config, image, 0);
+
+        config.set<int>(220, 1);
+
+        expect(scheduler.isPending() && (heard == 1), "both listeners notified");
+    }
+
+    config.set<int>(220, 2);
+
+    expect(heard == 2, "listener put back");
+
+    config.onChange(nullptr);
+}
+
+struct Case {
+    const char* name;
+    std::function<void()> run;
+};
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::string filter = (argc > 1) ? argv[1] : "";
+
+    const Case cases[] = {
+        { "recordlog", testRecordLog },
+        { "recordlog-full", testRecordLogFull },
+        { "counter-ring", testCounterRing },
+        { "counter-record", testCounterRecord },
+        { "dualslot", []() { testDualSlot(false); } },
+        { "dualslot-verify", []() { testDualSlot(true); } },
+        { "crc", testCrc },
+        { "image-crc", testImageCrc },
+        { "write-dirty", testWriteDirty },
+        { "scheduler-listener", testSchedulerListener },
+    };
+
+    for (auto & test: cases) {
+
+        if (!filter.empty() && (std::string(test.name).find(filter) == std::string::npos)) {
+            continue;
+        }
+
+        unsigned int failures = sFailures;
+
+        test.run();
+
+        std::printf("%s: %s\n", test.name, (sFailures == failures) ? "ok" : "FAILED");
+    }
+
+    return (sFailures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}